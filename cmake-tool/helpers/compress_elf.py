@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+#
+# Copyright 2021, HENSOLDT Cyber
+#
+# SPDX-License-Identifier: GPL-2.0-only
+#
+"""
+Compress an ELF file for the ELF-loader's CPIO archive.  The ELF header and the
+program header table are stored as they are, so the ELF-loader and `shoehorn`
+can parse them without decompressing anything.  The rest of the file is split
+into LZ4 compressed blocks that never cross the boundary of a segment's file
+data, so the ELF-loader can decompress each block straight to its destination.
+
+The layout must match elfloader-tool/src/compressed_elf.h.  If the `lz4`
+Python package is available it is used, otherwise a simple built-in LZ4 block
+compressor is.
+
+THIS IS NOT A STABLE API.  Use as a script, not a module.
+"""
+
+import argparse
+import io
+import struct
+import sys
+
+from typing import List, Optional
+
+import elftools.elf.elffile
+
+try:
+    import lz4.block
+except ImportError:
+    lz4 = None
+
+program_name = 'compress_elf'
+
+COMPRESSED_ELF_MAGIC = 0x345a4c45
+COMPRESSED_ELF_STORED = 1 << 31
+COMPRESSED_ELF_SCRATCH_SIZE = 4096
+
+# struct compressed_elf_header and struct compressed_elf_block
+HEADER_FORMAT = '<4I'
+BLOCK_FORMAT = '<2I'
+
+# Blocks of loaded data are decompressed in place, so their size only limits
+# how much an LZ4 match can refer back to.
+LOADED_BLOCK_SIZE = 256 * 1024
+
+# LZ4 block format constants.
+MIN_MATCH = 4
+LAST_LITERALS = 5
+MF_LIMIT = 12
+MAX_OFFSET = 0xffff
+
+
+def die(message: str, status: int = 3):
+    """
+    Emit fatal diagnostic `message` and exit with `status` (3 if not specified).
+    """
+    sys.stderr.write('{}: fatal error: {}\n'.format(program_name, message))
+    sys.exit(status)
+
+
+def pad(data: bytes) -> bytes:
+    return data + bytes(-len(data) % 4)
+
+
+def put_length(out: bytearray, n: int):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def lz4_compress_simple(data: bytes) -> bytes:
+    """
+    Compress `data` to a raw LZ4 block with a greedy single-entry hash table
+    match finder.  This is much slower than the `lz4` package and compresses
+    a bit worse, but produces valid blocks for any input.
+    """
+    out = bytearray()
+    table = {}
+    anchor = 0
+    pos = 0
+    limit = len(data) - MF_LIMIT
+
+    while pos < limit:
+        key = data[pos:pos + MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = pos
+        if candidate is None or pos - candidate > MAX_OFFSET:
+            pos += 1
+            continue
+
+        # Extend the match, the last literals must stay literals.
+        match_end = pos + MIN_MATCH
+        max_end = len(data) - LAST_LITERALS
+        while match_end < max_end and \
+                data[match_end] == data[candidate + match_end - pos]:
+            match_end += 1
+
+        literal_len = pos - anchor
+        match_len = match_end - pos - MIN_MATCH
+        token = (min(literal_len, 15) << 4) | min(match_len, 15)
+        out.append(token)
+        if literal_len >= 15:
+            put_length(out, literal_len - 15)
+        out += data[anchor:pos]
+        out += struct.pack('<H', pos - candidate)
+        if match_len >= 15:
+            put_length(out, match_len - 15)
+
+        pos = anchor = match_end
+
+    literal_len = len(data) - anchor
+    out.append(min(literal_len, 15) << 4)
+    if literal_len >= 15:
+        put_length(out, literal_len - 15)
+    out += data[anchor:]
+    return bytes(out)
+
+
+def lz4_compress(data: bytes) -> bytes:
+    """
+    Compress `data` to a raw LZ4 block, without any size prefix.
+    """
+    if lz4:
+        return lz4.block.compress(data, mode='high_compression',
+                                  store_size=False)
+    return lz4_compress_simple(data)
+
+
+def get_block_sizes(elf: elftools.elf.elffile.ELFFile, head_size: int,
+                    file_size: int) -> List[int]:
+    """
+    Split the ELF file after the head into blocks, at all boundaries of the
+    segments' file data.  This is where the ELF-loader sees the set of segments
+    that contain the data change.
+    """
+    segments = [(seg['p_offset'], seg['p_offset'] + seg['p_filesz'])
+                for seg in elf.iter_segments()
+                if seg['p_type'] == 'PT_LOAD' and seg['p_filesz'] != 0]
+    bounds = sorted(set([head_size, file_size]
+                        + [b for s in segments for b in s
+                           if head_size < b < file_size]))
+
+    sizes = []
+    for start, end in zip(bounds, bounds[1:]):
+        is_loaded = any(s <= start and end <= e for s, e in segments)
+        max_size = LOADED_BLOCK_SIZE if is_loaded \
+            else COMPRESSED_ELF_SCRATCH_SIZE
+        while start < end:
+            size = min(end - start, max_size)
+            sizes.append(size)
+            start += size
+    return sizes
+
+
+def compress_elf(data: bytes) -> bytes:
+    """
+    Return the compressed form of the ELF file `data`.
+    """
+    elf = elftools.elf.elffile.ELFFile(io.BytesIO(data))
+    # The ELF-loader checks the head is at least as large as a 64-bit ELF
+    # header, even for 32-bit files.
+    head_size = max(64, elf['e_ehsize'],
+                    elf['e_phoff'] + elf['e_phnum'] * elf['e_phentsize'])
+    head_size = min(head_size, len(data))
+
+    blocks = b''
+    pos = head_size
+    sizes = get_block_sizes(elf, head_size, len(data))
+    for size in sizes:
+        chunk = data[pos:pos + size]
+        compressed = lz4_compress(chunk)
+        if len(compressed) < size:
+            blocks += struct.pack(BLOCK_FORMAT, size, len(compressed))
+            blocks += pad(compressed)
+        else:
+            blocks += struct.pack(BLOCK_FORMAT, size,
+                                  size | COMPRESSED_ELF_STORED)
+            blocks += pad(chunk)
+        pos += size
+
+    header = struct.pack(HEADER_FORMAT, COMPRESSED_ELF_MAGIC, head_size,
+                         len(data), len(sizes))
+    return header + pad(data[:head_size]) + blocks
+
+
+def get_head(data: bytes) -> Optional[bytes]:
+    """
+    Return the uncompressed ELF headers if `data` is a compressed ELF file,
+    None otherwise.  They are enough to get the memory layout of the ELF file.
+    """
+    if len(data) < struct.calcsize(HEADER_FORMAT):
+        return None
+    magic, head_size, _, _ = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != COMPRESSED_ELF_MAGIC:
+        return None
+    start = struct.calcsize(HEADER_FORMAT)
+    return data[start:start + head_size]
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="""
+Compress the ELF file `input_filename` for the ELF-loader's CPIO archive and
+write the result to `output_filename`.
+""")
+    parser.add_argument('input_filename', nargs=1, type=str,
+                        help='ELF file to compress')
+    parser.add_argument('output_filename', nargs=1, type=str,
+                        help='compressed file to write')
+    args = parser.parse_args()
+
+    with open(args.input_filename[0], 'rb') as f:
+        data = f.read()
+
+    if len(data) > 0xffffffff:
+        die('ELF file "{}" too large'.format(args.input_filename[0]))
+
+    with open(args.output_filename[0], 'wb') as f:
+        f.write(compress_elf(data))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
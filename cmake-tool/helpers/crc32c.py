@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+#
+# Copyright 2021, HENSOLDT Cyber
+#
+# SPDX-License-Identifier: GPL-2.0-only
+#
+"""
+Print the CRC-32C of files in the format of sha256sum, for the ELF-loader
+configured with ElfloaderHashCRC32C.  Python's hashlib has no CRC-32C.
+
+THIS IS NOT A STABLE API.  Use as a script, not a module.
+"""
+
+import argparse
+import sys
+
+# reflected Castagnoli polynomial
+POLY = 0x82f63b78
+
+
+def make_table() -> list:
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ (POLY if crc & 1 else 0)
+        table.append(crc)
+    return table
+
+
+def crc32c(data: bytes) -> int:
+    table = make_table()
+    crc = 0xffffffff
+    for byte in data:
+        crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8)
+    return crc ^ 0xffffffff
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="""
+Print the CRC-32C of each file, most significant byte first.
+""")
+    parser.add_argument('files', nargs='+', type=str, help='files to check')
+    args = parser.parse_args()
+
+    for name in args.files:
+        with open(name, 'rb') as f:
+            print('{:08x}  {}'.format(crc32c(f.read()), name))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
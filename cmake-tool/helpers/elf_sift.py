@@ -46,6 +46,18 @@ def get_memory_usage(elf_file: BinaryIO, align: bool) -> int:
     return get_aligned_size(total) if align else total
 
 
+def get_physical_start(elf_file: BinaryIO) -> int:
+    """
+    Return the lowest physical address of the ELF segments that occupy memory
+    in the ELF object file `elf_file`.  This is where the ELF-loader puts the
+    kernel.
+    """
+
+    elf = elftools.elf.elffile.ELFFile(elf_file)
+    return min([seg['p_paddr'] for seg in elf.iter_segments()
+                if seg['p_memsz'] != 0])
+
+
 def get_memory_usage_from_file(filename: str, align: bool) -> int:
     """
     Return the size in bytes occuped in memory of the loadable ELF segments from
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+#
+# Copyright 2021, HENSOLDT Cyber
+#
+# SPDX-License-Identifier: GPL-2.0-only
+#
+"""
+Generate the hash tree of a file for the ELF-loader.  The file is split into
+leaves of a fixed size, each leaf gets its own hash and the root hash covers
+the header and all leaf hashes.  The ELF-loader checks the leaves
+independently, spread over all cores, and stops at the first bad one.
+
+The layout must match elfloader-tool/src/hash_tree.h.
+
+THIS IS NOT A STABLE API.  Use as a script, not a module.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+program_name = 'hash_tree'
+
+HASH_TREE_MAGIC = 0x45525448
+HASH_TREE_VERSION = 1
+HASH_TREE_MIN_LEAF_BITS = 12
+HASH_TREE_MAX_LEAF_BITS = 24
+HASH_TREE_HASH_LEN = 32
+
+# struct hash_tree without the root hash
+HEADER_FORMAT = '<6I'
+
+
+def die(message: str, status: int = 3):
+    """
+    Emit fatal diagnostic `message` and exit with `status` (3 if not specified).
+    """
+    sys.stderr.write('{}: fatal error: {}\n'.format(program_name, message))
+    sys.exit(status)
+
+
+def get_hash(hash_type: str, data: bytes) -> bytes:
+    """
+    Return the hash of `data`, padded to the size of a hash in the tree.
+    """
+    digest = hashlib.new(hash_type, data).digest()
+    return digest + bytes(HASH_TREE_HASH_LEN - len(digest))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="""
+Generate the hash tree the ELF-loader checks a file against, when it is
+configured with ElfloaderHashTree.
+""")
+    parser.add_argument('--hash', choices=['sha256', 'md5', 'blake2s'], required=True,
+                        help='hash algorithm the ELF-loader is configured for')
+    parser.add_argument('--leaf-bits', type=int, default=16,
+                        help='log2 of the leaf size (default: 16, i.e. 64 KiB)')
+    parser.add_argument('--output', required=True, type=str,
+                        help='hash tree file to write')
+    parser.add_argument('input', type=str, help='file to hash')
+    args = parser.parse_args()
+
+    if not HASH_TREE_MIN_LEAF_BITS <= args.leaf_bits <= HASH_TREE_MAX_LEAF_BITS:
+        die('leaf bits must be between {} and {}'.format(HASH_TREE_MIN_LEAF_BITS,
+                                                         HASH_TREE_MAX_LEAF_BITS))
+
+    with open(args.input, 'rb') as f:
+        data = f.read()
+    if len(data) >= 1 << 32:
+        die('{} is too large'.format(args.input))
+
+    leaf_size = 1 << args.leaf_bits
+    leaves = b''.join(get_hash(args.hash, data[offset:offset + leaf_size])
+                      for offset in range(0, len(data), leaf_size))
+    num_leaves = len(leaves) // HASH_TREE_HASH_LEN
+
+    header = struct.pack(HEADER_FORMAT, HASH_TREE_MAGIC, HASH_TREE_VERSION,
+                         args.leaf_bits, num_leaves, len(data), 0)
+    root = get_hash(args.hash, header + leaves)
+
+    with open(args.output, 'wb') as f:
+        f.write(header + root + leaves)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
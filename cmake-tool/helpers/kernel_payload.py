@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+#
+# Copyright 2021, HENSOLDT Cyber
+#
+# SPDX-License-Identifier: GPL-2.0-only
+#
+"""
+Split the kernel ELF file for a pre-positioned kernel.  The payload file gets
+the data of all loadable segments, laid out as in physical memory starting at
+the kernel's physical load address.  The ELF-loader's linker script places the
+payload at this address, so the kernel is in place once the ELF-loader image is
+loaded.  The headers file is the kernel ELF file reduced to the ELF header and
+the program header table, it goes into the ELF-loader's CPIO archive instead of
+the full kernel ELF file.
+
+THIS IS NOT A STABLE API.  Use as a script, not a module.
+"""
+
+import argparse
+import struct
+import sys
+
+import elftools.elf.elffile
+
+program_name = 'kernel_payload'
+
+
+def die(message: str, status: int = 3):
+    """
+    Emit fatal diagnostic `message` and exit with `status` (3 if not specified).
+    """
+    sys.stderr.write('{}: fatal error: {}\n'.format(program_name, message))
+    sys.exit(status)
+
+
+def get_payload(elf: elftools.elf.elffile.ELFFile) -> bytes:
+    """
+    Return the data of the loadable segments as laid out in physical memory.
+    The ELF-loader puts each segment at the same offset from the start of the
+    image in physical and virtual memory, so the payload must do so, too.
+    """
+    # Like elf_getMemoryBounds(), consider all segments that occupy memory.
+    segments = [seg for seg in elf.iter_segments() if seg['p_memsz'] != 0]
+    if not segments:
+        die('kernel has no segments that occupy memory')
+    min_vaddr = min(seg['p_vaddr'] for seg in segments)
+    min_paddr = min(seg['p_paddr'] for seg in segments)
+
+    payload = bytearray()
+    for seg in elf.iter_segments():
+        if seg['p_type'] != 'PT_LOAD' or seg['p_filesz'] == 0:
+            continue
+        offset = seg['p_vaddr'] - min_vaddr
+        if seg['p_paddr'] - min_paddr != offset:
+            die('segment at 0x{:x} has a different physical layout'
+                .format(seg['p_vaddr']))
+        end = offset + seg['p_filesz']
+        if end > len(payload):
+            payload.extend(bytes(end - len(payload)))
+        payload[offset:end] = seg.data()
+
+    return bytes(payload)
+
+
+def get_headers(data: bytes, elf: elftools.elf.elffile.ELFFile) -> bytes:
+    """
+    Return the ELF header and the program header table of the ELF file, with
+    the references to the section header table removed.
+    """
+    size = elf['e_phoff'] + elf['e_phnum'] * elf['e_phentsize']
+    headers = bytearray(data[:size])
+    endian = '<' if elf.little_endian else '>'
+    if elf.elfclass == 64:
+        struct.pack_into(endian + 'Q', headers, 0x28, 0)
+        struct.pack_into(endian + 'HH', headers, 0x3c, 0, 0)
+    else:
+        struct.pack_into(endian + 'I', headers, 0x20, 0)
+        struct.pack_into(endian + 'HH', headers, 0x30, 0, 0)
+    return bytes(headers)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="""
+Split the kernel ELF file `kernel_filename` into the payload that is placed at
+the kernel's physical address in the ELF-loader image and an ELF file with just
+the headers for the ELF-loader's CPIO archive.
+""")
+    parser.add_argument('--payload', required=True, type=str,
+                        help='payload file to write')
+    parser.add_argument('--headers', required=True, type=str,
+                        help='ELF headers file to write')
+    parser.add_argument('kernel_filename', nargs=1, type=str,
+                        help='kernel ELF file')
+    args = parser.parse_args()
+
+    with open(args.kernel_filename[0], 'rb') as f:
+        data = f.read()
+        elf = elftools.elf.elffile.ELFFile(f)
+        payload = get_payload(elf)
+        headers = get_headers(data, elf)
+
+    with open(args.payload, 'wb') as f:
+        f.write(payload)
+    with open(args.headers, 'wb') as f:
+        f.write(headers)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+#
+# Copyright 2021, HENSOLDT Cyber
+#
+# SPDX-License-Identifier: GPL-2.0-only
+#
+"""
+Generate the load plan for the ELF-loader.  The load plan is a binary table
+that describes for the kernel, the DTB and each rootserver which ranges of the
+archive member have to be copied, hashed or zeroed at boot time, together with
+the memory bounds, the entry point and the expected hash of the file.  It is
+added to the ELF-loader's CPIO archive as `load_plan.bin`, so the ELF-loader
+does not have to parse the ELF files itself.
+
+The layout must match elfloader-tool/src/load_plan.h.
+
+THIS IS NOT A STABLE API.  Use as a script, not a module.
+"""
+
+import argparse
+import hashlib
+import io
+import os.path
+import struct
+import sys
+
+from typing import List, Tuple
+
+import elftools.elf.elffile
+
+program_name = 'load_plan'
+
+LOAD_PLAN_MAGIC = 0x4c504c45
+LOAD_PLAN_VERSION = 1
+LOAD_PLAN_MAX_SIZE = 1 << 14
+LOAD_PLAN_NAME_LEN = 64
+LOAD_PLAN_HASH_LEN = 32
+
+HASH_TYPES = {'none': 0, 'sha256': 1, 'md5': 2, 'blake2s': 3}
+
+IMAGE_KERNEL = 1
+IMAGE_DTB = 2
+IMAGE_USER = 3
+
+OP_COPY_HASH = 1
+OP_COPY = 2
+OP_HASH = 3
+OP_ZERO = 4
+
+PAGE_SIZE = 4096
+
+# struct load_plan_header, struct load_plan_image and struct load_plan_op
+HEADER_FORMAT = '<6I'
+IMAGE_FORMAT = '<{}s4I7Q2I{}s'.format(LOAD_PLAN_NAME_LEN, LOAD_PLAN_HASH_LEN)
+OP_FORMAT = '<2I3Q'
+
+Op = Tuple[int, int, int, int]
+
+
+def die(message: str, status: int = 3):
+    """
+    Emit fatal diagnostic `message` and exit with `status` (3 if not specified).
+    """
+    sys.stderr.write('{}: fatal error: {}\n'.format(program_name, message))
+    sys.exit(status)
+
+
+def round_up_page(n: int) -> int:
+    return (n + PAGE_SIZE - 1) // PAGE_SIZE * PAGE_SIZE
+
+
+def get_ranges(bounds: List[int], segments: List[Tuple[int, int]], start: int,
+               end: int) -> List[Tuple[int, int, List[int]]]:
+    """
+    Split [start..end) at all segment boundaries.  Return a list of
+    (start, end, indices) tuples, where `indices` lists the segments that
+    contain the range.  This is the same walk the ELF-loader does when it
+    parses the ELF file at boot time.
+    """
+    points = sorted(set([start, end] + [b for b in bounds if start < b < end]))
+    ranges = []
+    for lo, hi in zip(points, points[1:]):
+        indices = [i for i, (s, e) in enumerate(segments) if s <= lo and hi <= e]
+        ranges.append((lo, hi, indices))
+    return ranges
+
+
+def plan_elf(data: bytes, hash_type: str) -> Tuple[dict, List[Op]]:
+    """
+    Compute the image description and the operations for an ELF file.
+    """
+    elf = elftools.elf.elffile.ELFFile(io.BytesIO(data))
+
+    # Like elf_getMemoryBounds(), consider all segments that occupy memory.
+    segments = [seg for seg in elf.iter_segments() if seg['p_memsz'] != 0]
+    if not segments:
+        die('ELF file has no segments that occupy memory')
+    virt_start = min(seg['p_vaddr'] for seg in segments)
+    virt_end = max(seg['p_vaddr'] + seg['p_memsz'] for seg in segments)
+    phys_start = min(seg['p_paddr'] for seg in segments)
+    phys_end = max(seg['p_paddr'] + seg['p_memsz'] for seg in segments)
+    virt_end = round_up_page(virt_end)
+
+    loads = [seg for seg in elf.iter_segments()
+             if seg['p_type'] == 'PT_LOAD' and seg['p_filesz'] != 0]
+    for seg in loads:
+        if seg['p_offset'] + seg['p_filesz'] > len(data):
+            die('segment exceeds ELF file')
+
+    ops = []
+
+    # Zero everything that is not backed by file data first.
+    mem_segments = [(seg['p_vaddr'], seg['p_vaddr'] + seg['p_filesz'])
+                    for seg in loads]
+    mem_bounds = [b for s in mem_segments for b in s]
+    for lo, hi, indices in get_ranges(mem_bounds, mem_segments, virt_start,
+                                      virt_end):
+        if not indices:
+            ops.append((OP_ZERO, lo - virt_start, 0, hi - lo))
+
+    # Then walk the file in order, so it can be hashed while it is copied.
+    file_segments = [(seg['p_offset'], seg['p_offset'] + seg['p_filesz'])
+                     for seg in loads]
+    file_bounds = [b for s in file_segments for b in s]
+    for lo, hi, indices in get_ranges(file_bounds, file_segments, 0, len(data)):
+        if not indices:
+            if hash_type != 'none':
+                ops.append((OP_HASH, 0, lo, hi - lo))
+            continue
+        for n, i in enumerate(indices):
+            seg = loads[i]
+            dest = seg['p_vaddr'] - virt_start + lo - seg['p_offset']
+            op_type = OP_COPY_HASH if n == 0 else OP_COPY
+            ops.append((op_type, dest, lo, hi - lo))
+
+    image = {
+        'file_size': len(data),
+        'phys_start': phys_start,
+        'phys_end': phys_end,
+        'virt_start': virt_start,
+        'virt_end': virt_end,
+        'virt_entry': elf['e_entry'],
+        'phdr_offset': elf['e_phoff'],
+        'phnum': elf['e_phnum'],
+        'phentsize': elf['e_phentsize'],
+    }
+    return image, ops
+
+
+def plan_dtb(data: bytes) -> Tuple[dict, List[Op]]:
+    """
+    Compute the image description for a DTB. There are no operations, the
+    ELF-loader packs the DTB while copying it and only checks its size here.
+    """
+    image = {
+        'file_size': len(data),
+        'phys_start': 0,
+        'phys_end': 0,
+        'virt_start': 0,
+        'virt_end': round_up_page(len(data)),
+        'virt_entry': 0,
+        'phdr_offset': 0,
+        'phnum': 0,
+        'phentsize': 0,
+    }
+    return image, []
+
+
+def get_hash(data: bytes, hash_type: str) -> bytes:
+    if hash_type == 'none':
+        return b''
+    return hashlib.new(hash_type, data).digest()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="""
+Generate the load plan for the ELF-loader from the kernel, the optional DTB and
+the rootserver images.  Images are identified by the base name of their file,
+which is the name of their member in the ELF-loader's CPIO archive.
+""")
+    parser.add_argument('--hash', choices=sorted(HASH_TYPES.keys()),
+                        default='none',
+                        help='hash algorithm the ELF-loader is configured for')
+    parser.add_argument('--kernel', type=str,
+                        help='kernel ELF file, unless the kernel is'
+                             ' pre-positioned')
+    parser.add_argument('--dtb', type=str, help='device tree binary')
+    parser.add_argument('--output', required=True, type=str,
+                        help='load plan file to write')
+    parser.add_argument('rootservers', nargs='*', type=str,
+                        help='rootserver ELF files')
+    args = parser.parse_args()
+
+    inputs = []
+    if args.kernel:
+        inputs.append((args.kernel, IMAGE_KERNEL))
+    if args.dtb:
+        inputs.append((args.dtb, IMAGE_DTB))
+    inputs += [(f, IMAGE_USER) for f in args.rootservers]
+
+    images = b''
+    ops = []
+    for filename, image_type in inputs:
+        name = os.path.basename(filename).encode()
+        if len(name) >= LOAD_PLAN_NAME_LEN:
+            die('image name "{}" too long'.format(filename))
+
+        with open(filename, 'rb') as f:
+            data = f.read()
+
+        if image_type == IMAGE_DTB:
+            image, image_ops = plan_dtb(data)
+        else:
+            image, image_ops = plan_elf(data, args.hash)
+
+        images += struct.pack(IMAGE_FORMAT, name, image_type, len(ops),
+                              len(image_ops), 0, image['file_size'],
+                              image['phys_start'], image['phys_end'],
+                              image['virt_start'], image['virt_end'],
+                              image['virt_entry'], image['phdr_offset'],
+                              image['phnum'], image['phentsize'],
+                              get_hash(data, args.hash))
+        ops += image_ops
+
+    plan = struct.pack(HEADER_FORMAT, LOAD_PLAN_MAGIC, LOAD_PLAN_VERSION,
+                       HASH_TYPES[args.hash], len(inputs), len(ops), 0)
+    plan += images
+    plan += b''.join(struct.pack(OP_FORMAT, op_type, 0, dest, src, size)
+                     for op_type, dest, src, size in ops)
+
+    if len(plan) > LOAD_PLAN_MAX_SIZE:
+        die('load plan size {} exceeds {} bytes'.format(len(plan),
+                                                        LOAD_PLAN_MAX_SIZE))
+
+    with open(args.output, 'wb') as f:
+        f.write(plan)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
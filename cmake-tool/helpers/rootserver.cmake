@@ -229,3 +229,32 @@ function(DeclareRootserver rootservername)
     set_property(TARGET rootserver_image PROPERTY IMAGE_NAME "${IMAGE_NAME_REL}")
     set_property(TARGET rootserver_image PROPERTY KERNEL_IMAGE_NAME "${KERNEL_IMAGE_NAME_REL}")
 endfunction(DeclareRootserver)
+
+# Add `rootservername` as rootserver image `index` for the ELF-loader, see the
+# ElfloaderRootserverImages and ElfloaderRootserverNodeMap options. Image 0 is the
+# one from `DeclareRootserver`, which must be called first.
+function(DeclareRootserverImage rootservername index)
+    if(NOT (KernelArchARM OR KernelArchRiscV))
+        message(FATAL_ERROR "Multiple rootserver images need the ELF-loader")
+    endif()
+    if(NOT TARGET rootserver_image)
+        message(FATAL_ERROR "DeclareRootserver must be called before DeclareRootserverImage")
+    endif()
+    if(NOT (index GREATER 0 AND index LESS ElfloaderRootserverImages))
+        message(FATAL_ERROR "Rootserver image index ${index} invalid")
+    endif()
+    SetSeL4Start(${rootservername})
+    set_property(
+        TARGET ${rootservername}
+        APPEND_STRING
+        PROPERTY LINK_FLAGS " -Wl,-T ${TLS_ROOTSERVER} "
+    )
+    add_dependencies(rootserver_image ${rootservername})
+    # Fix the output name, like DeclareRootserver does for the first image.
+    set_property(TARGET "${rootservername}" PROPERTY OUTPUT_NAME "${rootservername}")
+    get_property(dir TARGET "${rootservername}" PROPERTY BINARY_DIR)
+    set_property(
+        TARGET rootserver_image
+        PROPERTY ROOTSERVER_IMAGE_${index} "${dir}/${rootservername}"
+    )
+endfunction(DeclareRootserverImage)
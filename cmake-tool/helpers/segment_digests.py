@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+#
+# Copyright 2021, HENSOLDT Cyber
+#
+# SPDX-License-Identifier: GPL-2.0-only
+#
+"""
+Generate the segment digests of an ELF file for the ELF-loader.  Instead of the
+hash of the whole ELF file, the ELF-loader then checks each loadable segment at
+its destination after copying it: the digest of the segment's file data and
+that its zero fill is zero.  The program headers and the entry point are
+covered by a layout digest, which leaves out p_offset, so the digests of the
+full kernel ELF file also match the headers of a pre-positioned kernel.
+
+The layout must match elfloader-tool/src/segment_digests.h.
+
+THIS IS NOT A STABLE API.  Use as a script, not a module.
+"""
+
+import argparse
+import hashlib
+import io
+import struct
+import sys
+
+from typing import List, Tuple
+
+import elftools.elf.elffile
+
+program_name = 'segment_digests'
+
+SEGMENT_DIGESTS_MAGIC = 0x44474553
+SEGMENT_DIGESTS_VERSION = 1
+SEGMENT_DIGESTS_MAX_SEGMENTS = 32
+SEGMENT_DIGESTS_HASH_LEN = 32
+
+PT_LOAD = 1
+
+# struct segment_digests, struct segment_digest and struct layout_phdr
+HEADER_FORMAT = '<4I{}s'.format(SEGMENT_DIGESTS_HASH_LEN)
+SEGMENT_FORMAT = '<2Q{}s'.format(SEGMENT_DIGESTS_HASH_LEN)
+LAYOUT_PHDR_FORMAT = '<2I5Q'
+
+# type, flags, offset, vaddr, paddr, file size, memory size, alignment
+Phdr = Tuple[int, int, int, int, int, int, int, int]
+
+
+def die(message: str, status: int = 3):
+    """
+    Emit fatal diagnostic `message` and exit with `status` (3 if not specified).
+    """
+    sys.stderr.write('{}: fatal error: {}\n'.format(program_name, message))
+    sys.exit(status)
+
+
+def get_phdrs(elf: elftools.elf.elffile.ELFFile, data: bytes) -> List[Phdr]:
+    """
+    Return the raw program headers.  pyelftools decodes p_type to names, but
+    the layout digest needs the numbers, including the processor specific ones.
+    """
+    endian = '<' if elf.little_endian else '>'
+    if elf.elfclass == 32:
+        phdr_format = endian + '8I'
+    else:
+        phdr_format = endian + '2I6Q'
+
+    phdrs = []
+    for i in range(elf['e_phnum']):
+        offset = elf['e_phoff'] + i * elf['e_phentsize']
+        fields = struct.unpack_from(phdr_format, data, offset)
+        if elf.elfclass == 32:
+            p_type, p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, p_flags, \
+                p_align = fields
+        else:
+            p_type, p_flags, p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, \
+                p_align = fields
+        phdrs.append((p_type, p_flags, p_offset, p_vaddr, p_paddr, p_filesz,
+                      p_memsz, p_align))
+    return phdrs
+
+
+def get_digest(hash_type: str, data: bytes) -> bytes:
+    return hashlib.new(hash_type, data).digest()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="""
+Generate the segment digests the ELF-loader checks an ELF file against, when it
+is configured with ElfloaderSegmentDigests.
+""")
+    parser.add_argument('--hash', choices=['sha256', 'md5', 'blake2s'], required=True,
+                        help='hash algorithm the ELF-loader is configured for')
+    parser.add_argument('--output', required=True, type=str,
+                        help='segment digests file to write')
+    parser.add_argument('elf', type=str, help='ELF file')
+    args = parser.parse_args()
+
+    with open(args.elf, 'rb') as f:
+        data = f.read()
+    elf = elftools.elf.elffile.ELFFile(io.BytesIO(data))
+
+    layout = hashlib.new(args.hash)
+    segments = b''
+    num_segments = 0
+    for p_type, p_flags, p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, \
+            p_align in get_phdrs(elf, data):
+        layout.update(struct.pack(LAYOUT_PHDR_FORMAT, p_type, p_flags, p_vaddr,
+                                  p_paddr, p_filesz, p_memsz, p_align))
+        if p_type != PT_LOAD:
+            continue
+        if p_memsz < p_filesz or p_offset + p_filesz > len(data):
+            die('segment at 0x{:x} invalid'.format(p_vaddr))
+        digest = get_digest(args.hash, data[p_offset:p_offset + p_filesz])
+        segments += struct.pack(SEGMENT_FORMAT, p_filesz, p_memsz - p_filesz,
+                                digest)
+        num_segments += 1
+    layout.update(struct.pack('<Q', elf['e_entry']))
+
+    if num_segments > SEGMENT_DIGESTS_MAX_SEGMENTS:
+        die('{} loadable segments, at most {} are supported'
+            .format(num_segments, SEGMENT_DIGESTS_MAX_SEGMENTS))
+
+    with open(args.output, 'wb') as f:
+        f.write(struct.pack(HEADER_FORMAT, SEGMENT_DIGESTS_MAGIC,
+                            SEGMENT_DIGESTS_VERSION, num_segments, 0,
+                            layout.digest()))
+        f.write(segments)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
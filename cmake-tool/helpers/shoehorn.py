@@ -24,6 +24,7 @@ import sys
 
 import libarchive
 
+import compress_elf
 import elf_sift
 import platform_sift
 
@@ -78,6 +79,12 @@ def get_bytes(entry: libarchive.entry.ArchiveEntry) -> io.BytesIO:
     """
     bytes = bytearray()
     bytes.extend([byte for block in entry.get_blocks() for byte in block])
+    # For a compressed ELF file, the uncompressed headers are all we need to
+    # get its memory layout.
+    head = compress_elf.get_head(bytes)
+    if head is not None:
+        debug('using the headers of compressed ELF file {}'.format(entry.name))
+        return io.BytesIO(head)
     return io.BytesIO(bytes)
 
 
@@ -126,6 +133,10 @@ sufficiently-large memory region.
                         default=False, action='store_true',
                         help='assume ELF-loader will put rootservers at top of'
                              ' memory')
+    parser.add_argument('--kernel-payload', dest='kernel_payload',
+                        default=False, action='store_true',
+                        help='also define the physical address of the kernel'
+                             ' payload placed in the ELF-loader image')
     parser.add_argument('platform_filename', nargs=1, type=str,
                         help='YAML description of platform parameters (e.g.,'
                              ' platform_gen.yaml)')
@@ -137,6 +148,7 @@ sufficiently-large memory region.
     image = args.payload_filename[0]
     image_size = os.path.getsize(image)
     do_load_rootservers_high = args.load_rootservers_high
+    do_kernel_payload = args.kernel_payload
     platform = platform_sift.load_data(args.platform_filename[0])
 
     rootservers = []
@@ -225,6 +237,18 @@ sufficiently-large memory region.
 
     sys.stdout.write('#define IMAGE_START_ADDR 0x{load:x}\n'
                      .format(load=image_start_address))
+
+    if do_kernel_payload:
+        # The pre-positioned kernel's data is linked into the ELF-loader image
+        # at the kernel's physical address.  The archive holds just its ELF
+        # headers, which is all we need here.
+        kernel_payload_address = elf_sift.get_physical_start(kernel_elf)
+        if kernel_payload_address + kernel_size > image_start_address:
+            die('kernel payload at 0x{:x} overlaps ELF-loader at 0x{:x}'
+                .format(kernel_payload_address, image_start_address), status=1)
+        sys.stdout.write('#define KERNEL_PAYLOAD_ADDR 0x{load:x}\n'
+                         .format(load=kernel_payload_address))
+
     return 0
 
 
@@ -41,6 +41,7 @@
 #define TCR_ORGN_MASK     ((3 << 10) | (3 << 26))
 
 #define TCR_SH0_ISH       (3 << 12)
+#define TCR_EPD1          (1 << 23)
 #define TCR_SHARED        ((3 << 12) | (3 << 28))
 
 #define TCR_TG0_4K        (0 << 14)
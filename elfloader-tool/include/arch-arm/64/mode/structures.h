@@ -32,3 +32,10 @@ extern uint64_t _boot_pmd_up[BIT(PMD_BITS)];
 extern uint64_t _boot_pgd_down[BIT(PGD_BITS)];
 extern uint64_t _boot_pud_down[BIT(PUD_BITS)];
 
+/* Number of 1 GiB blocks the load mapping can split into 2 MiB blocks */
+#define LOAD_PMD_COUNT          8
+
+extern uint64_t _load_pgd[BIT(PGD_BITS)];
+extern uint64_t _load_pud[BIT(PUD_BITS)];
+extern uint64_t _load_pmd[LOAD_PMD_COUNT][BIT(PMD_BITS)];
+
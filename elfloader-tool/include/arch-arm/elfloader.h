@@ -34,6 +34,22 @@ extern void flush_dcache(void);
 extern void cpu_idle(void);
 
 
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+/* Identity mapping for loading the images with the caches on. */
+int init_load_vspace(void);
+void clean_dcache_range(uintptr_t start, uintptr_t end);
+extern void arm_enable_load_mmu(void);
+extern void arm_disable_load_mmu(void);
+extern void arm_enable_hyp_load_mmu(void);
+extern void arm_disable_hyp_load_mmu(void);
+
+/* Set before the secondary CPUs are started, if the caches are used. */
+extern int is_load_cached;
+void enable_load_mmu(void);
+void disable_load_mmu(void);
+#endif
+
+void smp_start_cpus(void);
 void smp_boot(void);
 
 /* Secure monitor call */
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <autoconf.h>
+#include <elfloader/gen_config.h>
 #include <elfloader_common.h>
 
 /* This is a low level binary interface, thus we do not preserve the type
@@ -25,3 +26,17 @@ typedef void (*init_riscv_kernel_t)(word_t ui_p_reg_start,
                                     word_t core_id
 #endif
                                    );
+
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+/*
+ * Set by arch_init_primitives() if all harts have the vector extension, then
+ * memcpy() and memzero() use it. Every other hart must call
+ * riscv_vector_enable() before it copies anything, and all harts must call
+ * riscv_vector_disable() before entering the kernel.
+ */
+extern int riscv_vector_enabled;
+void riscv_vector_enable(void);
+void riscv_vector_disable(void);
+void *riscv_vector_memcpy(void *dest, void const *src, size_t n);
+void riscv_vector_memzero(void *s, size_t n);
+#endif
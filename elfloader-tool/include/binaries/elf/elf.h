@@ -348,6 +348,76 @@ void elf_getProgramHeaderInfo(
     uint64_t *p_offset,
     uint64_t *p_memsz);
 
+/*
+ * A program header with all fields widened to 64 bits, so 32-bit and 64-bit
+ * ELF files look the same.
+ */
+struct elf_segment {
+    uint32_t type;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t vaddr;
+    uint64_t paddr;
+    uint64_t file_size;
+    uint64_t mem_size;
+    uint64_t align;
+};
+
+/*
+ * An ELF file that has been checked and parsed once by elf_view_init(). The
+ * class is resolved and the program header table is known to be within the
+ * file, so going over the segments needs no further checks or dispatching.
+ * The file data of the segments is not checked, it may even be missing.
+ */
+struct elf_view {
+    void const *file;
+    size_t file_size;
+    int is_elf32;
+    void const *phdrs;
+    uint16_t phnum;
+    uint16_t phentsize;
+    /* Offset of the first byte after the program header table. */
+    size_t phdrs_end;
+    uint64_t entry;
+    /* Bounds of all segments that occupy memory, like elf_getMemoryBounds()
+     * returns them.
+     */
+    uint64_t min_vaddr;
+    uint64_t max_vaddr;
+    uint64_t min_paddr;
+    uint64_t max_paddr;
+};
+
+/**
+ * Check the ELF file at 'file' of 'file_size' bytes and set up 'view' for it.
+ *
+ * \return 0 on success, -1 if the file is not a valid ELF file.
+ */
+int elf_view_init(
+    struct elf_view *view,
+    void const *file,
+    size_t file_size);
+
+/**
+ * Get program header 'i', which must be less than view->phnum.
+ */
+void elf_view_get_segment(
+    struct elf_view const *view,
+    unsigned int i,
+    struct elf_segment *seg);
+
+/**
+ * Find the first PT_LOAD segment at index '*i' or above. Typical use is
+ *
+ *   for (unsigned int i = 0; elf_view_next_load_segment(view, &i, &seg); i++)
+ *
+ * \return 1 if a segment was found, then '*i' is its index, 0 otherwise.
+ */
+int elf_view_next_load_segment(
+    struct elf_view const *view,
+    unsigned int *i,
+    struct elf_segment *seg);
+
 #if 0
 /*
  * Returns a pointer to the program segment table, which is an array of
@@ -75,7 +75,7 @@ struct image_info {
 };
 
 extern struct image_info kernel_info;
-extern struct image_info user_info;
+extern struct image_info user_info[];
 extern void const *dtb;
 
 /* Symbols defined in linker scripts. */
@@ -83,10 +83,18 @@ extern char _text[];
 extern char _end[];
 extern char _archive_start[];
 extern char _archive_start_end[];
+extern char _archive_end[];
+#ifdef CONFIG_ELFLOADER_KERNEL_PREPOSITIONED
+extern char _kernel_payload_start[];
+extern char _kernel_payload_end[];
+#endif
 
 /* Clear BSS. */
 void clear_bss(void);
 
+/* Index of the user image that 'node' starts. */
+unsigned int get_node_user_image(unsigned int node);
+
 /* Load images. */
 int load_images(
     struct image_info *kernel_info,
@@ -97,6 +105,15 @@ int load_images(
     void const **chosen_dtb,
     size_t *chosen_dtb_size);
 
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+/* How a physical address range overlaps with the platform's memory. */
+#define RAM_OVERLAP_NONE    0
+#define RAM_OVERLAP_PARTIAL 1
+#define RAM_OVERLAP_FULL    2
+
+int get_ram_overlap(uint64_t start, uint64_t end);
+#endif
+
 /* Platform functions */
 void platform_init(void);
 void init_cpus(void);
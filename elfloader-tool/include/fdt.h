@@ -6,5 +6,75 @@
 
 #pragma once
 
+#include <types.h>
+
 size_t fdt_size(
     void const *fdt);
+
+/*
+ * Copy the FDT to 'dest' without the free space that may be at its end or
+ * between its blocks, without NOPs and without strings that are no longer
+ * used. Returns the size of the packed FDT, or 0 if it could not be packed
+ * into 'dest_size' bytes. 'dest' must not overlap with the FDT.
+ */
+size_t fdt_pack(
+    void *dest,
+    size_t dest_size,
+    void const *fdt);
+
+/*
+ * Called for each property of a CPU node, 'cpu' counts the CPU nodes from 0.
+ */
+typedef void (*fdt_cpu_prop_fn_t)(
+    void *arg,
+    unsigned int cpu,
+    char const *name,
+    void const *value,
+    uint32_t len);
+
+/*
+ * Call 'fn' for each property of each node under /cpus whose name is "cpu" or
+ * starts with "cpu@". Returns the number of CPU nodes, or -1 if the FDT is
+ * invalid.
+ */
+int fdt_for_each_cpu_prop(
+    void const *fdt,
+    fdt_cpu_prop_fn_t fn,
+    void *arg);
+
+/*
+ * Get the value of the property 'name' of the node 'node' right below the root
+ * node, e.g. "cpus". Returns NULL if there is no such property.
+ */
+void const *fdt_get_prop(
+    void const *fdt,
+    char const *node,
+    char const *name,
+    uint32_t *len);
+
+/*
+ * Add 'extra' bytes of free space at the end of the FDT, the memory after it
+ * must be free. Returns the new size of the FDT, or 0 if it is invalid.
+ */
+size_t fdt_grow(
+    void *fdt,
+    size_t extra);
+
+/*
+ * The free space at the end of the FDT that fdt_add_chosen_prop() can use, 0
+ * if the blocks of the FDT are not in the usual order.
+ */
+size_t fdt_free_space(
+    void const *fdt);
+
+/*
+ * Add the property 'name' with a value of 'len' bytes to /chosen, taking the
+ * space from the free space at the end of the FDT. The node is created if
+ * there is none, a property of the same name is replaced. Returns where the
+ * zeroed value is, for the caller to fill in, or NULL if there is not enough
+ * free space or the FDT is invalid.
+ */
+void *fdt_add_chosen_prop(
+    void *fdt,
+    char const *name,
+    uint32_t len);
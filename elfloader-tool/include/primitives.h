@@ -0,0 +1,44 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <types.h>
+
+/*
+ * The loader primitives that have faster variants on some CPUs. The table
+ * starts out with the portable variants, which work on every CPU of the
+ * architecture. primitives_init() probes the CPU once at startup and puts in
+ * the variants it can use, before any other core is started. memcpy(),
+ * memzero() and the hashes call through the table.
+ */
+struct primitives {
+    void *(*memcpy)(void *dest, void const *src, size_t n);
+    void (*memzero)(void *s, size_t n);
+    void (*sha256_blocks)(uint32_t h[8], uint8_t const *data, size_t blocks);
+    uint32_t (*crc32c_update)(uint32_t crc, uint8_t const *data, size_t len);
+    /* The smallest data cache line, for cache maintenance by address. */
+    size_t dcache_line_size;
+    /* The names of the variants, for the boot log. */
+    char const *memcpy_name;
+    char const *memzero_name;
+    char const *sha256_name;
+    char const *crc32c_name;
+};
+
+extern struct primitives primitives;
+
+/* Probe the CPU and fill in the table. 'dtb' may be NULL. */
+void primitives_init(void const *dtb);
+
+/* Implemented by each architecture, called by primitives_init(). */
+void arch_init_primitives(struct primitives *p, void const *dtb);
+
+/* The portable variants. clear_bss() calls default_memzero() directly, as it
+ * runs before the ELF-loader may have moved itself to its link address.
+ */
+void *default_memcpy(void *dest, void const *src, size_t n);
+void default_memzero(void *s, size_t n);
@@ -15,3 +15,8 @@ void *memset(void *s, int c, size_t n);
 void *memmove(void *dest, const void *src, size_t n);
 void *memcpy(void *dest, const void *src, size_t n);
 
+/* Zero 'n' bytes at 's', with the variant primitives_init() picked for the
+ * CPU. memset() uses it for zeroes, too.
+ */
+void memzero(void *s, size_t n);
+
@@ -4,9 +4,14 @@
  * SPDX-License-Identifier: GPL-2.0-only
  */
 
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
 #include <types.h>
 #include <elfloader.h>
+#include <primitives.h>
 #include <mode/structures.h>
+#include <armv/machine.h>
 
 #define ARM_VECTOR_TABLE    0xffff0000
 extern char arm_vector_table[1];
@@ -79,3 +84,62 @@ void init_hyp_boot_vspace(struct image_info *kernel_info)
                                 | BIT(0); /* Valid */
     }
 }
+
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+
+#if CONFIG_MAX_NUM_NODES > 1
+#define LOAD_SHAREABLE      BIT(16)
+#else
+#define LOAD_SHAREABLE      0
+#endif
+
+#define LOAD_NORMAL_SECTION (BIT(12) | BIT(3) | BIT(2) /* write-back, write-allocate */ \
+                             | LOAD_SHAREABLE \
+                             | BIT(10) /* kernel-only access */ \
+                             | BIT(1)) /* 1M section */
+#define LOAD_DEVICE_SECTION (BIT(4) /* execute never */ \
+                             | BIT(10) /* kernel-only access */ \
+                             | BIT(1)) /* 1M section, strongly ordered */
+
+/*
+ * Create the identity mapping that is used while the images are loaded. The
+ * platform's memory is normal cacheable memory, everything else is strongly
+ * ordered.
+ *
+ * Returns 0 if the ELF-loader itself ends up in normal memory, otherwise the
+ * mapping can't be used.
+ */
+int init_load_vspace(void)
+{
+    for (uint32_t i = 0; i < BIT(PD_BITS); i++) {
+        uint64_t paddr = (uint64_t)i << ARM_SECTION_BITS;
+        if (get_ram_overlap(paddr, paddr + BIT(ARM_SECTION_BITS)) == RAM_OVERLAP_FULL) {
+            _load_pd[i] = (uint32_t)paddr | LOAD_NORMAL_SECTION;
+        } else {
+            _load_pd[i] = (uint32_t)paddr | LOAD_DEVICE_SECTION;
+        }
+    }
+
+    /* Code can't be fetched from strongly ordered memory. */
+    uint64_t start = ROUND_DOWN((paddr_t)_text, ARM_SECTION_BITS);
+    uint64_t end = ROUND_UP((uint64_t)(paddr_t)_end, ARM_SECTION_BITS);
+    if (get_ram_overlap(start, end) != RAM_OVERLAP_FULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Write back the data cache lines of [start..end) to the point of coherency. */
+void clean_dcache_range(uintptr_t start, uintptr_t end)
+{
+    size_t line_size = primitives.dcache_line_size;
+
+    for (uintptr_t va = start & ~(line_size - 1); va < end; va += line_size) {
+        /* DCCMVAC */
+        asm volatile("mcr p15, 0, %0, c7, c10, 1" :: "r"(va) : "memory");
+    }
+    dsb();
+}
+
+#endif /* CONFIG_ELFLOADER_CACHED_LOAD */
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <elfloader_common.h>
+#include <primitives.h>
+
+/* DminLine is the log2 of the number of words in the smallest line. */
+#define CTR_DMINLINE(ctr)   (((ctr) >> 16) & 0xf)
+
+/* AArch32 has no variants of the primitives, just the cache line size. */
+void arch_init_primitives(struct primitives *p, UNUSED void const *dtb)
+{
+    uint32_t ctr;
+
+    asm volatile("mrc p15, 0, %0, c0, c0, 1" : "=r"(ctr));
+    p->dcache_line_size = 4 << CTR_DMINLINE(ctr);
+}
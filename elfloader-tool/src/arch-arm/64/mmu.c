@@ -8,9 +8,11 @@
 #include <elfloader/gen_config.h>
 #include <types.h>
 #include <elfloader.h>
+#include <primitives.h>
 #include <mode/structures.h>
 #include <printf.h>
 #include <abort.h>
+#include <armv/machine.h>
 
 /*
 * Create a "boot" page table, which contains a 1:1 mapping below
@@ -89,3 +91,83 @@ void init_hyp_boot_vspace(struct image_info *kernel_info)
                           | BIT(0); /* 2M block */
     }
 }
+
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+
+#define LOAD_NORMAL_BLOCK   (BIT(10) /* access flag */ \
+                             | (3 << 8) /* inner shareable */ \
+                             | (4 << 2) /* MT_NORMAL memory */ \
+                             | BIT(0)) /* block */
+#define LOAD_DEVICE_BLOCK   ((1ull << 54) /* execute never */ \
+                             | BIT(10) /* access flag */ \
+                             | (0 << 2) /* strongly ordered memory */ \
+                             | BIT(0)) /* block */
+
+static uint64_t load_block(paddr_t paddr, word_t size_bits)
+{
+    if (get_ram_overlap(paddr, paddr + BIT(size_bits)) == RAM_OVERLAP_FULL) {
+        return paddr | LOAD_NORMAL_BLOCK;
+    }
+    return paddr | LOAD_DEVICE_BLOCK;
+}
+
+/*
+ * Create the identity mapping that is used while the images are loaded. It
+ * covers the first 512 GiB of the physical address space. The platform's
+ * memory is normal cacheable memory, everything else is strongly ordered. A
+ * 1 GiB block that is only partly memory is split into 2 MiB blocks, blocks
+ * that are still partly memory are strongly ordered.
+ *
+ * Returns 0 if the ELF-loader itself ends up in normal memory, otherwise the
+ * mapping can't be used.
+ */
+int init_load_vspace(void)
+{
+    unsigned int num_pmds = 0;
+
+    _load_pgd[0] = ((uintptr_t)_load_pud) | BIT(1) | BIT(0); /* its a page table */
+
+    for (word_t i = 0; i < BIT(PUD_BITS); i++) {
+        paddr_t paddr = i << ARM_1GB_BLOCK_BITS;
+        int overlap = get_ram_overlap(paddr, paddr + BIT(ARM_1GB_BLOCK_BITS));
+        if ((overlap != RAM_OVERLAP_PARTIAL) || (num_pmds == LOAD_PMD_COUNT)) {
+            _load_pud[i] = load_block(paddr, ARM_1GB_BLOCK_BITS);
+            continue;
+        }
+
+        uint64_t *pmd = _load_pmd[num_pmds++];
+        for (word_t j = 0; j < BIT(PMD_BITS); j++) {
+            pmd[j] = load_block(paddr + (j << ARM_2MB_BLOCK_BITS),
+                                ARM_2MB_BLOCK_BITS);
+        }
+        _load_pud[i] = ((uintptr_t)pmd) | BIT(1) | BIT(0); /* its a page table */
+    }
+
+    /* Code can't be fetched from strongly ordered memory. */
+    paddr_t start = ROUND_DOWN((paddr_t)_text, ARM_2MB_BLOCK_BITS);
+    paddr_t end = ROUND_UP((paddr_t)_end, ARM_2MB_BLOCK_BITS);
+    if ((GET_PGD_INDEX(end - 1) != 0) ||
+        (get_ram_overlap(start, end) != RAM_OVERLAP_FULL)) {
+        return -1;
+    }
+    for (word_t i = GET_PUD_INDEX(start); i <= GET_PUD_INDEX(end - 1); i++) {
+        if ((_load_pud[i] & LOAD_DEVICE_BLOCK) == LOAD_DEVICE_BLOCK) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Write back the data cache lines of [start..end) to the point of coherency. */
+void clean_dcache_range(uintptr_t start, uintptr_t end)
+{
+    size_t line_size = primitives.dcache_line_size;
+
+    for (uintptr_t va = start & ~(line_size - 1); va < end; va += line_size) {
+        asm volatile("dc cvac, %0" :: "r"(va) : "memory");
+    }
+    dsb();
+}
+
+#endif /* CONFIG_ELFLOADER_CACHED_LOAD */
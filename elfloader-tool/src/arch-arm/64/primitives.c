@@ -0,0 +1,61 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <elfloader_common.h>
+#include <primitives.h>
+#include <armv/machine.h>
+
+#include "../../crypt_sha256.h"
+#include "../../crypt_crc32c.h"
+
+#define ID_AA64ISAR0_SHA2(isar0)    (((isar0) >> 12) & 0xf)
+#define ID_AA64ISAR0_CRC32(isar0)   (((isar0) >> 16) & 0xf)
+#define DCZID_EL0_DZP               BIT(4)
+/* DminLine is the log2 of the number of words in the smallest line. */
+#define CTR_EL0_DMINLINE(ctr)       (((ctr) >> 16) & 0xf)
+
+/* Implemented in string.S */
+void memzero_dc_zva(void *s, size_t n);
+
+/*
+ * All cores of the supported platforms have the same features, so the ID
+ * registers of the core that boots are good for all of them. The features are
+ * read from the ID registers rather than derived from MIDR, so cores that are
+ * not known here get the variants they support, too.
+ */
+void arch_init_primitives(struct primitives *p, UNUSED void const *dtb)
+{
+    word_t isar0, dczid, ctr;
+
+    MRS("id_aa64isar0_el1", isar0);
+    MRS("dczid_el0", dczid);
+    MRS("ctr_el0", ctr);
+
+    p->dcache_line_size = 4 << CTR_EL0_DMINLINE(ctr);
+
+    if (!(dczid & DCZID_EL0_DZP)) {
+        p->memzero = memzero_dc_zva;
+        p->memzero_name = "dc zva";
+    }
+
+#ifdef CONFIG_ELFLOADER_SHA256_ARMV8_CE
+    if (ID_AA64ISAR0_SHA2(isar0)) {
+        p->sha256_blocks = sha256_ce_blocks;
+        p->sha256_name = "armv8 ce";
+    }
+#endif
+
+#ifdef CONFIG_ELFLOADER_CRC32C_ARMV8
+    if (ID_AA64ISAR0_CRC32(isar0)) {
+        p->crc32c_update = crc32c_update_arm;
+        p->crc32c_name = "armv8 crc32";
+    }
+#endif
+}
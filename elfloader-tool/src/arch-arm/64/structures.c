@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: GPL-2.0-only
  */
 
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
 #include <elfloader.h>
 #include <types.h>
 #include <mode/structures.h>
@@ -16,3 +19,10 @@ uint64_t _boot_pmd_up[BIT(PMD_BITS)] ALIGN(BIT(PMD_SIZE_BITS));
 /* Paging structures for identity mapping */
 uint64_t _boot_pgd_down[BIT(PGD_BITS)] ALIGN(BIT(PGD_SIZE_BITS));
 uint64_t _boot_pud_down[BIT(PUD_BITS)] ALIGN(BIT(PUD_SIZE_BITS));
+
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+/* Paging structures for the identity mapping used while loading */
+uint64_t _load_pgd[BIT(PGD_BITS)] ALIGN(BIT(PGD_SIZE_BITS));
+uint64_t _load_pud[BIT(PUD_BITS)] ALIGN(BIT(PUD_SIZE_BITS));
+uint64_t _load_pmd[LOAD_PMD_COUNT][BIT(PMD_BITS)] ALIGN(BIT(PMD_SIZE_BITS));
+#endif
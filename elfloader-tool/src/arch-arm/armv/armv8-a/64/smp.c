@@ -18,7 +18,7 @@ unsigned long core_stacks[CONFIG_MAX_NUM_NODES][STACK_SIZE / sizeof(unsigned lon
 volatile int core_up[CONFIG_MAX_NUM_NODES];
 
 extern void core_entry_head(void);
-extern void non_boot_main(void);
+extern void non_boot_main(int id);
 
 void core_entry(uint64_t sp)
 {
@@ -30,7 +30,7 @@ void core_entry(uint64_t sp)
 
     core_up[id] = id;
     dmb();
-    non_boot_main();
+    non_boot_main(id);
 }
 
 int is_core_up(int i)
@@ -17,8 +17,11 @@
 #include <armv/smp.h>
 #include <armv/machine.h>
 
+#include "../workers.h"
+
 #if CONFIG_MAX_NUM_NODES > 1
 static volatile int non_boot_lock = 0;
+static int cpus_started = 0;
 
 void arm_disable_dcaches(void);
 
@@ -27,11 +30,25 @@ extern uint32_t dtb_size;
 
 WEAK void non_boot_init(void) {}
 
-/* Entry point for all CPUs other than the initial. */
-void non_boot_main(void)
+/* Entry point for all CPUs other than the initial, 'id' is the logical ID. */
+void non_boot_main(int id)
 {
 #ifndef CONFIG_ARCH_AARCH64
     arm_disable_dcaches();
+#endif
+#ifdef CONFIG_ELFLOADER_PARALLEL_LOAD
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+    if (is_load_cached) {
+        enable_load_mmu();
+    }
+#endif
+    /* Help loading the images until the first CPU releases us. */
+    worker_loop(id);
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+    if (is_load_cached) {
+        disable_load_mmu();
+    }
+#endif
 #endif
     /* Spin until the first CPU has finished initialisation. */
     while (!non_boot_lock) {
@@ -57,9 +74,10 @@ void non_boot_main(void)
     }
 
     /* Jump to the kernel. */
-    ((init_arm_kernel_t)kernel_info.virt_entry)(user_info.phys_region_start,
-                                                user_info.phys_region_end, user_info.phys_virt_offset,
-                                                user_info.virt_entry, (paddr_t)dtb, dtb_size);
+    struct image_info const *user = &user_info[get_node_user_image(id)];
+    ((init_arm_kernel_t)kernel_info.virt_entry)(user->phys_region_start,
+                                                user->phys_region_end, user->phys_virt_offset,
+                                                user->virt_entry, (paddr_t)dtb, dtb_size);
 
     printf("AP Kernel returned back to the elf-loader.\n");
     abort();
@@ -126,12 +144,24 @@ WEAK void init_cpus(void)
 #endif
 }
 
-void smp_boot(void)
+/*
+ * Bring up the secondary CPUs, they wait in non_boot_main() until smp_boot()
+ * lets them enter the kernel. This can be called before smp_boot() already.
+ */
+void smp_start_cpus(void)
 {
 #ifndef CONFIG_ARCH_AARCH64
     arm_disable_dcaches();
 #endif
-    init_cpus();
+    if (!cpus_started) {
+        init_cpus();
+        cpus_started = 1;
+    }
+}
+
+void smp_boot(void)
+{
+    smp_start_cpus();
     non_boot_lock = 1;
 }
 #endif /* CONFIG_MAX_NUM_NODES */
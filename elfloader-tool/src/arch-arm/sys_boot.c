@@ -15,10 +15,18 @@
 #include <abort.h>
 #include <strops.h>
 #include <cpuid.h>
+#include <primitives.h>
 
 #include <binaries/efi/efi.h>
 #include <elfloader.h>
 
+#include "../workers.h"
+#include "../timestamps.h"
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+#include "../warm_boot.h"
+#endif
+
 /* 0xd00dfeed in big endian */
 #define DTB_MAGIC (0xedfe0dd0)
 
@@ -31,13 +39,68 @@ char core_stack_alloc[CONFIG_MAX_NUM_NODES][BIT(PAGE_BITS)];
 #endif
 
 struct image_info kernel_info;
-struct image_info user_info;
+struct image_info user_info[CONFIG_ELFLOADER_ROOTSERVER_IMAGES];
 void const *dtb;
 size_t dtb_size;
 
 extern void finish_relocation(int offset, void *_dynamic, unsigned int total_offset);
 void continue_boot(int was_relocated);
 
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+int is_load_cached;
+
+/* Called by every CPU that takes part in loading the images. */
+void enable_load_mmu(void)
+{
+#ifdef CONFIG_ARCH_AARCH64
+    if (is_hyp_mode()) {
+        arm_enable_hyp_load_mmu();
+        return;
+    }
+#endif
+    arm_enable_load_mmu();
+}
+
+void disable_load_mmu(void)
+{
+#ifdef CONFIG_ARCH_AARCH64
+    if (is_hyp_mode()) {
+        arm_disable_hyp_load_mmu();
+        return;
+    }
+#endif
+    arm_disable_load_mmu();
+}
+
+/*
+ * Write back everything that was written with the caches on, before the MMU is
+ * turned off. Cleaning by address also reaches the lines the secondary CPUs
+ * hold.
+ */
+static void finish_cached_load(void)
+{
+    clean_dcache_range(kernel_info.phys_region_start,
+                       kernel_info.phys_region_end);
+    /* The ELF headers are kept in the page after each rootserver. */
+    for (unsigned int i = 0; i < ARRAY_SIZE(user_info); i++) {
+        clean_dcache_range(user_info[i].phys_region_start,
+                           user_info[i].phys_region_end + BIT(PAGE_BITS));
+    }
+    if (dtb) {
+        clean_dcache_range((uintptr_t)dtb, (uintptr_t)dtb + dtb_size);
+    }
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    clean_dcache_range(WARM_BOOT_RECORD_PADDR,
+                       WARM_BOOT_RECORD_PADDR + BIT(PAGE_BITS));
+#endif
+    /* The archive was only read. */
+    clean_dcache_range((uintptr_t)_text, (uintptr_t)_archive_start);
+    clean_dcache_range((uintptr_t)_archive_end, (uintptr_t)_end);
+
+    disable_load_mmu();
+}
+#endif /* CONFIG_ELFLOADER_CACHED_LOAD */
+
 /*
  * Make sure the ELF loader is below the kernel's first virtual address
  * so that when we enable the MMU we can keep executing.
@@ -104,7 +167,9 @@ void main(UNUSED void *arg)
     void *bootloader_dtb = NULL;
 
     /* initialize platform to a state where we can print to a UART */
+    int ts = timestamp_begin(TIMESTAMP_INITIALISE_DEVICES);
     initialise_devices();
+    timestamp_end(ts, 0);
     platform_init();
 
     /* Print welcome message. */
@@ -138,18 +203,51 @@ void main(UNUSED void *arg)
         printf("No DTB passed in from boot loader.\n");
     }
 
+    /* Before any secondary core starts and uses the table. */
+    primitives_init(bootloader_dtb);
+
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+    /* AArch32 HYP mode would need an LPAE page table. */
+    is_load_cached = (0 == init_load_vspace());
+#ifndef CONFIG_ARCH_AARCH64
+    if (is_hyp_mode()) {
+        is_load_cached = 0;
+    }
+#endif
+    if (!is_load_cached) {
+        printf("Can't use the caches, loading images uncached\n");
+    }
+#endif
+
+#if CONFIG_MAX_NUM_NODES > 1 && defined(CONFIG_ELFLOADER_PARALLEL_LOAD)
+    /* Bring up the secondary cores now, so they help loading the images. */
+    smp_start_cpus();
+#endif
+
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+    if (is_load_cached) {
+        enable_load_mmu();
+    }
+#endif
+
     /* Unpack ELF images into memory. */
     unsigned int num_apps = 0;
-    int ret = load_images(&kernel_info, &user_info, 1, &num_apps,
-                          bootloader_dtb, &dtb, &dtb_size);
+    int ret = load_images(&kernel_info, user_info, ARRAY_SIZE(user_info),
+                          &num_apps, bootloader_dtb, &dtb, &dtb_size);
+    workers_release();
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+    if (is_load_cached) {
+        finish_cached_load();
+    }
+#endif
     if (0 != ret) {
         printf("ERROR: image loading failed\n");
         abort();
     }
 
-    if (num_apps != 1) {
-        printf("ERROR: expected to load just 1 app, actually loaded %u apps\n",
-               num_apps);
+    if (num_apps != ARRAY_SIZE(user_info)) {
+        printf("ERROR: expected to load %zu apps, actually loaded %u apps\n",
+               ARRAY_SIZE(user_info), num_apps);
         abort();
     }
     /*
@@ -175,7 +273,9 @@ void continue_boot(int was_relocated)
      * driver model so all its pointers are set up properly.
      */
     if (was_relocated) {
+        int ts = timestamp_begin(TIMESTAMP_INITIALISE_DEVICES);
         initialise_devices();
+        timestamp_end(ts, 0);
     }
 
 #if (defined(CONFIG_ARCH_ARM_V7A) || defined(CONFIG_ARCH_ARM_V8A)) && !defined(CONFIG_ARM_HYPERVISOR_SUPPORT)
@@ -185,6 +285,7 @@ void continue_boot(int was_relocated)
     }
 #endif
     /* Setup MMU. */
+    int ts = timestamp_begin(TIMESTAMP_INIT_BOOT_VSPACE);
     if (is_hyp_mode()) {
 #ifdef CONFIG_ARCH_AARCH64
         extern void disable_caches_hyp();
@@ -196,28 +297,43 @@ void continue_boot(int was_relocated)
          * just in case the kernel does not support hyp mode. */
         init_boot_vspace(&kernel_info);
     }
+    timestamp_end(ts, 0);
+
+    /* The DTB is written before any CPU may have it in its caches, so the
+     * phases from here on are only printed.
+     */
+    if (dtb) {
+        timestamps_export((void *)dtb);
+    }
 
 #if CONFIG_MAX_NUM_NODES > 1
+    ts = timestamp_begin(TIMESTAMP_SMP_BOOT);
     smp_boot();
+    timestamp_end(ts, 0);
 #endif /* CONFIG_MAX_NUM_NODES */
 
     if (is_hyp_mode()) {
         printf("Enabling hypervisor MMU and paging\n");
+        ts = timestamp_begin(TIMESTAMP_MMU_ENABLE);
         arm_enable_hyp_mmu();
     } else {
         printf("Enabling MMU and paging\n");
+        ts = timestamp_begin(TIMESTAMP_MMU_ENABLE);
         arm_enable_mmu();
     }
+    timestamp_end(ts, 0);
 
     /* Enter kernel. The UART may no longer be accessible here. */
     if ((uintptr_t)uart_get_mmio() < kernel_info.virt_region_start) {
+        timestamps_print();
         printf("Jumping to kernel-image entry point...\n\n");
     }
 
-    ((init_arm_kernel_t)kernel_info.virt_entry)(user_info.phys_region_start,
-                                                user_info.phys_region_end,
-                                                user_info.phys_virt_offset,
-                                                user_info.virt_entry,
+    struct image_info const *user = &user_info[get_node_user_image(0)];
+    ((init_arm_kernel_t)kernel_info.virt_entry)(user->phys_region_start,
+                                                user->phys_region_end,
+                                                user->phys_virt_offset,
+                                                user->virt_entry,
                                                 (word_t)dtb,
                                                 dtb_size);
 
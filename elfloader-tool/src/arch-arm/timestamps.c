@@ -0,0 +1,71 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <elfloader_common.h>
+
+#include "../timestamps.h"
+
+/*
+ * The physical count of the generic timer. It is what the kernel reads from
+ * the virtual counter, once CNTVOFF has been reset. The ISB keeps the read
+ * from happening ahead of the code that is timed.
+ */
+
+#ifdef CONFIG_ARCH_AARCH64
+
+uint64_t timestamp_read(void)
+{
+    uint64_t count;
+    asm volatile("isb\n"
+                 "mrs %0, cntpct_el0" : "=r"(count) :: "memory");
+    return count;
+}
+
+uint64_t timestamp_frequency(UNUSED void const *dtb)
+{
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq;
+}
+
+#else /* not CONFIG_ARCH_AARCH64 */
+
+/* ID_PFR1.GenTimer, cores like the Cortex-A9 have no generic timer. */
+static int has_generic_timer(void)
+{
+    uint32_t pfr1;
+    asm volatile("mrc p15, 0, %0, c0, c1, 1" : "=r"(pfr1));
+    return ((pfr1 >> 16) & 0xf) != 0;
+}
+
+uint64_t timestamp_read(void)
+{
+    uint32_t lo, hi;
+
+    if (!has_generic_timer()) {
+        return 0;
+    }
+    asm volatile("isb\n"
+                 "mrrc p15, 0, %0, %1, c14" : "=r"(lo), "=r"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t timestamp_frequency(UNUSED void const *dtb)
+{
+    uint32_t freq;
+
+    if (!has_generic_timer()) {
+        return 0;
+    }
+    asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(freq));
+    return freq;
+}
+
+#endif /* [not] CONFIG_ARCH_AARCH64 */
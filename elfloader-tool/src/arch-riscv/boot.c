@@ -14,6 +14,10 @@
 #include <abort.h>
 #include <cpio/cpio.h>
 #include <sbi.h>
+#include <primitives.h>
+
+#include "../workers.h"
+#include "../timestamps.h"
 
 #define PT_LEVEL_1 1
 #define PT_LEVEL_2 2
@@ -49,7 +53,7 @@
 #define VIRT_PHYS_ALIGNED(virt, phys, level_bits) (IS_ALIGNED((virt), (level_bits)) && IS_ALIGNED((phys), (level_bits)))
 
 struct image_info kernel_info;
-struct image_info user_info;
+struct image_info user_info[CONFIG_ELFLOADER_ROOTSERVER_IMAGES];
 
 unsigned long l1pt[PTES_PER_PT] __attribute__((aligned(4096)));
 #if __riscv_xlen == 64
@@ -166,6 +170,25 @@ static void set_and_wait_for_ready(int hart_id, int core_id)
         while (__atomic_load_n(&core_ready[i], __ATOMIC_RELAXED) == 0) ;
     }
 }
+
+static void start_secondary_harts(int hart_id)
+{
+    while (__atomic_exchange_n(&mutex, 1, __ATOMIC_ACQUIRE) != 0);
+    printf("Main entry hart_id:%d\n", hart_id);
+    __atomic_store_n(&mutex, 0, __ATOMIC_RELEASE);
+
+    /* Unleash secondary cores */
+    __atomic_store_n(&secondary_go, 1, __ATOMIC_RELEASE);
+
+    /* Start all cores */
+    int i = 0;
+    while (i < CONFIG_MAX_NUM_NODES && hsm_exists) {
+        i++;
+        if (i != hart_id) {
+            sbi_hart_start(i, secondary_harts, i);
+        }
+    }
+}
 #endif
 
 static inline void sfence_vma(void)
@@ -194,55 +217,72 @@ static int run_elfloader(UNUSED int hart_id, void *bootloader_dtb)
 {
     int ret;
 
+    /* The secondary harts use the table when they start, so do it first. */
+    primitives_init(bootloader_dtb);
+
+#if CONFIG_MAX_NUM_NODES > 1 && defined(CONFIG_ELFLOADER_PARALLEL_LOAD)
+    /* Start the secondary harts now, so they help loading the images. */
+    start_secondary_harts(hart_id);
+#endif
+
     /* Unpack ELF images into memory. */
     unsigned int num_apps = 0;
-    ret = load_images(&kernel_info, &user_info, 1, &num_apps,
-                      bootloader_dtb, &dtb, &dtb_size);
+    ret = load_images(&kernel_info, user_info, ARRAY_SIZE(user_info),
+                      &num_apps, bootloader_dtb, &dtb, &dtb_size);
+    workers_release();
     if (0 != ret) {
         printf("ERROR: image loading failed, code %d\n", ret);
         return -1;
     }
 
-    if (num_apps != 1) {
-        printf("ERROR: expected to load just 1 app, actually loaded %u apps\n",
-               num_apps);
+    if (num_apps != ARRAY_SIZE(user_info)) {
+        printf("ERROR: expected to load %zu apps, actually loaded %u apps\n",
+               ARRAY_SIZE(user_info), num_apps);
         return -1;
     }
 
+    /* The RISC-V counterpart of init_boot_vspace(). */
+    int ts = timestamp_begin(TIMESTAMP_INIT_BOOT_VSPACE);
     ret = map_kernel_window(&kernel_info);
+    timestamp_end(ts, 0);
     if (0 != ret) {
         printf("ERROR: could not map kernel window, code %d\n", ret);
         return -1;
     }
 
-#if CONFIG_MAX_NUM_NODES > 1
-    while (__atomic_exchange_n(&mutex, 1, __ATOMIC_ACQUIRE) != 0);
-    printf("Main entry hart_id:%d\n", hart_id);
-    __atomic_store_n(&mutex, 0, __ATOMIC_RELEASE);
-
-    /* Unleash secondary cores */
-    __atomic_store_n(&secondary_go, 1, __ATOMIC_RELEASE);
-
-    /* Start all cores */
-    int i = 0;
-    while (i < CONFIG_MAX_NUM_NODES && hsm_exists) {
-        i++;
-        if (i != hart_id) {
-            sbi_hart_start(i, secondary_harts, i);
-        }
+    /* The DTB is written before the other harts may enter the kernel, so the
+     * phases from here on are only printed.
+     */
+    if (dtb) {
+        timestamps_export((void *)dtb);
     }
 
+#if CONFIG_MAX_NUM_NODES > 1
+    ts = timestamp_begin(TIMESTAMP_SMP_BOOT);
+#ifndef CONFIG_ELFLOADER_PARALLEL_LOAD
+    start_secondary_harts(hart_id);
+#endif
     set_and_wait_for_ready(hart_id, 0);
+    timestamp_end(ts, 0);
+#endif
+
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+    /* The kernel does not expect any vector state. */
+    riscv_vector_disable();
 #endif
 
     printf("Enabling MMU and paging\n");
+    ts = timestamp_begin(TIMESTAMP_MMU_ENABLE);
     enable_virtual_memory();
+    timestamp_end(ts, 0);
 
+    timestamps_print();
     printf("Jumping to kernel-image entry point...\n\n");
-    ((init_riscv_kernel_t)kernel_info.virt_entry)(user_info.phys_region_start,
-                                                  user_info.phys_region_end,
-                                                  user_info.phys_virt_offset,
-                                                  user_info.virt_entry,
+    struct image_info const *user = &user_info[get_node_user_image(0)];
+    ((init_riscv_kernel_t)kernel_info.virt_entry)(user->phys_region_start,
+                                                  user->phys_region_end,
+                                                  user->phys_virt_offset,
+                                                  user->virt_entry,
                                                   (word_t)dtb,
                                                   dtb_size
 #if CONFIG_MAX_NUM_NODES > 1
@@ -263,21 +303,37 @@ void secondary_entry(int hart_id, int core_id)
 {
     while (__atomic_load_n(&secondary_go, __ATOMIC_ACQUIRE) == 0) ;
 
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+    if (riscv_vector_enabled) {
+        riscv_vector_enable();
+    }
+#endif
+
     while (__atomic_exchange_n(&mutex, 1, __ATOMIC_ACQUIRE) != 0);
     printf("Secondary entry hart_id:%d core_id:%d\n", hart_id, core_id);
     __atomic_store_n(&mutex, 0, __ATOMIC_RELEASE);
 
+#ifdef CONFIG_ELFLOADER_PARALLEL_LOAD
+    /* Help loading the images until the main hart releases us. */
+    worker_loop(core_id);
+#endif
+
     set_and_wait_for_ready(hart_id, core_id);
 
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+    riscv_vector_disable();
+#endif
+
     enable_virtual_memory();
 
 
     /* If adding or modifying these parameters you will need to update
         the registers in head.S */
-    ((init_riscv_kernel_t)kernel_info.virt_entry)(user_info.phys_region_start,
-                                                  user_info.phys_region_end,
-                                                  user_info.phys_virt_offset,
-                                                  user_info.virt_entry,
+    struct image_info const *user = &user_info[get_node_user_image(core_id)];
+    ((init_riscv_kernel_t)kernel_info.virt_entry)(user->phys_region_start,
+                                                  user->phys_region_end,
+                                                  user->phys_virt_offset,
+                                                  user->virt_entry,
                                                   (word_t)dtb,
                                                   dtb_size,
                                                   hart_id,
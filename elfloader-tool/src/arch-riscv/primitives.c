@@ -0,0 +1,258 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+#include <printf.h>
+#include <fdt.h>
+#include <primitives.h>
+#include <elfloader.h>
+
+#include "../crypt_sha256.h"
+
+/* The extensions the primitives have variants for. */
+#define ISA_V           BIT(0)
+#define ISA_ZICBOZ      BIT(1)
+#define ISA_ZKNH        BIT(2)
+
+/* The vector state field of sstatus, it is Off after reset. */
+#define SSTATUS_VS          (3ul << 9)
+#define SSTATUS_VS_INITIAL  (1ul << 9)
+
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+int riscv_vector_enabled;
+#endif
+
+/* The state of the CPU node whose properties are being looked at. */
+struct isa_check {
+    int cpu;
+    word_t isa;
+    int is_disabled;
+    uint32_t cboz_block_size;
+    /* The extensions all enabled harts so far have in common. */
+    word_t common_isa;
+    uint32_t common_cboz_block_size;
+};
+
+/* Whether 'value' is a string of 'len' bytes, including its terminator. */
+static int is_string(char const *value, uint32_t len)
+{
+    return (len > 0) && (value[len - 1] == '\0');
+}
+
+/* The bit of the extension 'name' of 'len' characters. Zknh is part of Zkn,
+ * which is part of Zk.
+ */
+static word_t extension_isa(char const *name, size_t len)
+{
+    if ((len == 1) && (name[0] == 'v')) {
+        return ISA_V;
+    }
+    if ((len == 6) && (0 == strncmp(name, "zicboz", len))) {
+        return ISA_ZICBOZ;
+    }
+    if (((len == 4) && (0 == strncmp(name, "zknh", len))) ||
+        ((len == 3) && (0 == strncmp(name, "zkn", len))) ||
+        ((len == 2) && (0 == strncmp(name, "zk", len)))) {
+        return ISA_ZKNH;
+    }
+    return 0;
+}
+
+/*
+ * In a riscv,isa string like "rv64imafdcv_zicboz_zknh", the single letter
+ * extensions follow the base ISA up to the first underscore, then the multi
+ * letter extensions are separated by underscores.
+ */
+static word_t parse_isa(char const *isa)
+{
+    word_t found = 0;
+
+    if (0 != strncmp(isa, "rv", 2)) {
+        return 0;
+    }
+    for (isa += 2; (*isa >= '0') && (*isa <= '9'); isa++);
+    for (; (*isa != '\0') && (*isa != '_'); isa++) {
+        found |= extension_isa(isa, 1);
+    }
+    while (*isa == '_') {
+        char const *name = ++isa;
+        for (; (*isa != '\0') && (*isa != '_'); isa++);
+        found |= extension_isa(name, isa - name);
+    }
+    return found;
+}
+
+/* riscv,isa-extensions is a list of strings, one per extension. */
+static word_t parse_isa_extensions(char const *list, uint32_t len)
+{
+    word_t found = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += strlen(list + pos) + 1) {
+        found |= extension_isa(list + pos, strlen(list + pos));
+    }
+    return found;
+}
+
+static void finish_cpu(struct isa_check *check)
+{
+    if ((check->cpu < 0) || check->is_disabled) {
+        return;
+    }
+    check->common_isa &= check->isa;
+    /* cbo.zero can only be used if all harts zero blocks of the same size. */
+    if (check->cboz_block_size == 0) {
+        return;
+    }
+    if (check->common_cboz_block_size == 0) {
+        check->common_cboz_block_size = check->cboz_block_size;
+    } else if (check->cboz_block_size != check->common_cboz_block_size) {
+        check->common_isa &= ~ISA_ZICBOZ;
+    }
+}
+
+static void check_cpu_prop(
+    void *arg,
+    unsigned int cpu,
+    char const *name,
+    void const *value,
+    uint32_t len)
+{
+    struct isa_check *check = arg;
+
+    /* The properties of a CPU node are reported one after the other. */
+    if ((int)cpu != check->cpu) {
+        finish_cpu(check);
+        check->cpu = cpu;
+        check->isa = 0;
+        check->is_disabled = 0;
+        check->cboz_block_size = 0;
+    }
+
+    if (0 == strcmp(name, "riscv,cboz-block-size")) {
+        if (len == 4) {
+            uint8_t const *be = value;
+            check->cboz_block_size = ((uint32_t)be[0] << 24) |
+                                     ((uint32_t)be[1] << 16) |
+                                     ((uint32_t)be[2] << 8) | be[3];
+        }
+        return;
+    }
+    if (!is_string(value, len)) {
+        return;
+    }
+    if (0 == strcmp(name, "riscv,isa")) {
+        check->isa |= parse_isa(value);
+    } else if (0 == strcmp(name, "riscv,isa-extensions")) {
+        check->isa |= parse_isa_extensions(value, len);
+    } else if (0 == strcmp(name, "status")) {
+        check->is_disabled = (0 != strcmp(value, "okay")) &&
+                             (0 != strcmp(value, "ok"));
+    }
+}
+
+/* The extensions all enabled harts have, any hart may help loading. */
+static word_t probe_isa(void const *dtb, uint32_t *cboz_block_size)
+{
+    struct isa_check check = { .cpu = -1, .common_isa = ~(word_t)0 };
+
+    if (!dtb) {
+        printf("  no DTB, using the default primitives\n");
+        return 0;
+    }
+
+    int num_cpus = fdt_for_each_cpu_prop(dtb, check_cpu_prop, &check);
+    finish_cpu(&check);
+    if (num_cpus <= 0) {
+        printf("  no harts in the DTB, using the default primitives\n");
+        return 0;
+    }
+
+    *cboz_block_size = check.common_cboz_block_size;
+    return check.common_isa;
+}
+
+#ifdef CONFIG_ELFLOADER_RISCV_ZICBOZ
+/* The size of the blocks cbo.zero zeroes, a power of two. */
+static size_t cboz_block_size;
+
+/* cbo.zero of Zicboz, as .insn so the assembler does not need to know it. The
+ * SBI firmware must have enabled it for S-mode in menvcfg.
+ */
+static inline void cbo_zero(void *block)
+{
+    asm volatile(".insn i 0x0f, 2, x0, %0, 4" :: "r"(block) : "memory");
+}
+
+/* Zero whole cache blocks, the rest with default_memzero(). */
+static void memzero_cbo(void *s, size_t n)
+{
+    char *mem = (char *)s;
+    char *end = mem + n;
+
+    if (n >= 2 * cboz_block_size) {
+        size_t head = -(uintptr_t)mem & (cboz_block_size - 1);
+        default_memzero(mem, head);
+        for (mem += head; (size_t)(end - mem) >= cboz_block_size;
+             mem += cboz_block_size) {
+            cbo_zero(mem);
+        }
+    }
+    default_memzero(mem, end - mem);
+}
+#endif /* CONFIG_ELFLOADER_RISCV_ZICBOZ */
+
+void arch_init_primitives(UNUSED struct primitives *p, void const *dtb)
+{
+    uint32_t block_size = 0;
+    UNUSED word_t isa = probe_isa(dtb, &block_size);
+
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+    if (isa & ISA_V) {
+        riscv_vector_enable();
+        riscv_vector_enabled = 1;
+        p->memcpy = riscv_vector_memcpy;
+        p->memcpy_name = "vector";
+        p->memzero = riscv_vector_memzero;
+        p->memzero_name = "vector";
+    }
+#endif
+
+#ifdef CONFIG_ELFLOADER_RISCV_ZICBOZ
+    /* Zeroing whole blocks also saves reading them into the cache first. */
+    if (block_size == 0) {
+        block_size = CONFIG_ELFLOADER_RISCV_ZICBOZ_BLOCK_SIZE;
+    }
+    if ((isa & ISA_ZICBOZ) && (block_size >= sizeof(word_t)) &&
+        ((block_size & (block_size - 1)) == 0)) {
+        cboz_block_size = block_size;
+        p->memzero = memzero_cbo;
+        p->memzero_name = "cbo.zero";
+    }
+#endif
+
+#ifdef CONFIG_ELFLOADER_SHA256_RISCV_ZKNH
+    if (isa & ISA_ZKNH) {
+        p->sha256_blocks = sha256_blocks_zknh;
+        p->sha256_name = "zknh";
+    }
+#endif
+}
+
+#ifdef CONFIG_ELFLOADER_RISCV_VECTOR
+void riscv_vector_enable(void)
+{
+    asm volatile("csrs sstatus, %0" :: "r"(SSTATUS_VS_INITIAL) : "memory");
+}
+
+void riscv_vector_disable(void)
+{
+    asm volatile("csrc sstatus, %0" :: "r"(SSTATUS_VS) : "memory");
+}
+#endif
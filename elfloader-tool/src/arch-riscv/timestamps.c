@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <fdt.h>
+#include <strops.h>
+#include <elfloader_common.h>
+
+#include "../timestamps.h"
+
+uint64_t timestamp_read(void)
+{
+#if __riscv_xlen == 32
+    uint32_t lo, hi, hi2;
+    /* Read again if the low half has wrapped in between. */
+    do {
+        asm volatile("rdtimeh %0\n"
+                     "rdtime %1\n"
+                     "rdtimeh %2" : "=r"(hi), "=r"(lo), "=r"(hi2) :: "memory");
+    } while (hi != hi2);
+    return ((uint64_t)hi << 32) | lo;
+#else
+    uint64_t count;
+    asm volatile("rdtime %0" : "=r"(count) :: "memory");
+    return count;
+#endif
+}
+
+static uint64_t get_be_cells(uint8_t const *value, uint32_t len)
+{
+    uint64_t val = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        val = (val << 8) | value[i];
+    }
+    return val;
+}
+
+static void check_cpu_prop(
+    void *arg,
+    UNUSED unsigned int cpu,
+    char const *name,
+    void const *value,
+    uint32_t len)
+{
+    uint64_t *freq = arg;
+
+    if ((*freq == 0) && ((len == 4) || (len == 8)) &&
+        (0 == strcmp(name, "timebase-frequency"))) {
+        *freq = get_be_cells(value, len);
+    }
+}
+
+/* The frequency of the time CSR is only known from the DTB. It is usually in
+ * /cpus, but may also be in each CPU node.
+ */
+uint64_t timestamp_frequency(void const *dtb)
+{
+    uint64_t freq = 0;
+    uint32_t len;
+
+    if (!dtb) {
+        return 0;
+    }
+    void const *value = fdt_get_prop(dtb, "cpus", "timebase-frequency", &len);
+    if (value && ((len == 4) || (len == 8))) {
+        return get_be_cells(value, len);
+    }
+    fdt_for_each_cpu_prop(dtb, check_cpu_prop, &freq);
+    return freq;
+}
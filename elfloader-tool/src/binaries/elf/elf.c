@@ -245,6 +245,127 @@ int elf_getMemoryBounds(
     return 1;
 }
 
+int elf_view_init(
+    struct elf_view *view,
+    void const *file,
+    size_t file_size)
+{
+    uint64_t phoff;
+
+    if ((file_size < sizeof(struct Elf32_Header)) ||
+        (elf_checkFile(file) != 0)) {
+        return -1;
+    }
+
+    view->file = file;
+    view->file_size = file_size;
+    view->is_elf32 = ISELF32(file);
+    if (view->is_elf32) {
+        struct Elf32_Header const *header = file;
+        phoff = header->e_phoff;
+        view->phnum = header->e_phnum;
+        view->phentsize = header->e_phentsize;
+        view->entry = header->e_entry;
+        if ((view->phnum > 0) &&
+            (view->phentsize < sizeof(struct Elf32_Phdr))) {
+            return -1;
+        }
+    } else {
+        struct Elf64_Header const *header = file;
+        if (file_size < sizeof(*header)) {
+            return -1;
+        }
+        phoff = elf64_read64(&header->e_phoff);
+        view->phnum = header->e_phnum;
+        view->phentsize = header->e_phentsize;
+        view->entry = elf64_read64(&header->e_entry);
+        if ((view->phnum > 0) &&
+            (view->phentsize < sizeof(struct Elf64_Phdr))) {
+            return -1;
+        }
+    }
+
+    /* The table is in the file and its entries are aligned. */
+    uint64_t phdrs_size = (uint64_t)view->phnum * view->phentsize;
+    if ((phoff > file_size) || (phdrs_size > file_size - phoff) ||
+        ((view->phnum > 0) && ((phoff | view->phentsize) & 3))) {
+        return -1;
+    }
+    view->phdrs = (void const *)((uintptr_t)file + (uintptr_t)phoff);
+    view->phdrs_end = (size_t)(phoff + phdrs_size);
+
+    view->min_vaddr = UINT64_MAX;
+    view->max_vaddr = 0;
+    view->min_paddr = UINT64_MAX;
+    view->max_paddr = 0;
+    for (unsigned int i = 0; i < view->phnum; i++) {
+        struct elf_segment seg;
+        elf_view_get_segment(view, i, &seg);
+        if (seg.mem_size == 0) {
+            continue;
+        }
+        if (seg.vaddr < view->min_vaddr) {
+            view->min_vaddr = seg.vaddr;
+        }
+        if (seg.vaddr + seg.mem_size > view->max_vaddr) {
+            view->max_vaddr = seg.vaddr + seg.mem_size;
+        }
+        if (seg.paddr < view->min_paddr) {
+            view->min_paddr = seg.paddr;
+        }
+        if (seg.paddr + seg.mem_size > view->max_paddr) {
+            view->max_paddr = seg.paddr + seg.mem_size;
+        }
+    }
+
+    return 0;
+}
+
+void elf_view_get_segment(
+    struct elf_view const *view,
+    unsigned int i,
+    struct elf_segment *seg)
+{
+    uintptr_t phdr = (uintptr_t)view->phdrs + (uintptr_t)i * view->phentsize;
+
+    if (view->is_elf32) {
+        struct Elf32_Phdr const *p = (void const *)phdr;
+        seg->type = p->p_type;
+        seg->flags = p->p_flags;
+        seg->offset = p->p_offset;
+        seg->vaddr = p->p_vaddr;
+        seg->paddr = p->p_paddr;
+        seg->file_size = p->p_filesz;
+        seg->mem_size = p->p_memsz;
+        seg->align = p->p_align;
+    } else {
+        struct Elf64_Phdr const *p = (void const *)phdr;
+        seg->type = p->p_type;
+        seg->flags = p->p_flags;
+        seg->offset = elf64_read64(&p->p_offset);
+        seg->vaddr = elf64_read64(&p->p_vaddr);
+        seg->paddr = elf64_read64(&p->p_paddr);
+        seg->file_size = elf64_read64(&p->p_filesz);
+        seg->mem_size = elf64_read64(&p->p_memsz);
+        seg->align = elf64_read64(&p->p_align);
+    }
+}
+
+int elf_view_next_load_segment(
+    struct elf_view const *view,
+    unsigned int *i,
+    struct elf_segment *seg)
+{
+    for (; *i < view->phnum; (*i)++) {
+        elf_view_get_segment(view, *i, seg);
+        if (seg->type == PT_LOAD) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int elf_vaddrInProgramHeader(
     void const *elfFile,
     uint16_t ph,
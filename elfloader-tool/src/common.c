@@ -12,23 +12,49 @@
 #include <types.h>
 #include <strops.h>
 #include <binaries/elf/elf.h>
-#include <cpio/cpio.h>
 
 #include <elfloader.h>
 #include <fdt.h>
+#include <primitives.h>
 
-#ifdef CONFIG_HASH_SHA
-#include "crypt_sha256.h"
-#elif CONFIG_HASH_MD5
-#include "crypt_md5.h"
+#include "cpio_index.h"
+#include "hash.h"
+#include "workers.h"
+#include "timestamps.h"
+
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+#include "load_plan.h"
 #endif
 
-#include "hash.h"
+#ifdef CONFIG_ELFLOADER_COMPRESSED_ARCHIVE
+#include "compressed_elf.h"
+#include "lz4.h"
+#endif
 
-#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+#include "warm_boot.h"
+#endif
+
+#ifdef CONFIG_ELFLOADER_SEGMENT_DIGESTS
+#include "segment_digests.h"
+#endif
+
+#ifdef CONFIG_ELFLOADER_HASH_TREE
+#include "hash_tree.h"
+#else
+/* Without hash tree support there is just an opaque placeholder type. */
+struct hash_tree;
+#endif
+
+#if defined(CONFIG_ELFLOADER_ROOTSERVERS_LAST) || \
+    defined(CONFIG_ELFLOADER_CACHED_LOAD)
 #include <platform_info.h> // this provides memory_region
 #endif
 
+#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
+#include "placement.h"
+#endif
+
 extern char _bss[];
 extern char _bss_end[];
 
@@ -37,16 +63,111 @@ extern char _bss_end[];
  */
 void clear_bss(void)
 {
-    char *start = _bss;
-    char *end = _bss_end;
-    while (start < end) {
-        *start = 0;
-        start++;
-    }
+    default_memzero(_bss, _bss_end - _bss);
 }
 
 #define KEEP_HEADERS_SIZE BIT(PAGE_BITS)
 
+/* The user images are parsed when they are placed and loaded later. */
+static struct elf_view user_elf_views[CONFIG_ELFLOADER_ROOTSERVER_IMAGES];
+
+#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
+
+/* Free memory the user images are placed in. */
+static struct placement user_placement;
+
+static void print_map_entry(char const *name, uint64_t start, uint64_t end)
+{
+    printf("  [%llx..%llx] %s\n", (unsigned long long)start,
+           (unsigned long long)end - 1, name);
+}
+
+/*
+ * Set up the free memory for the user images, which is all memory regions of
+ * the platform except the ELF-loader, the load record and
+ * [used_start..used_end).
+ */
+static int init_user_placement(uint64_t used_start, uint64_t used_end)
+{
+    int ret;
+
+    placement_init(&user_placement);
+    for (int i = 0; i < num_memory_regions; i++) {
+        ret = placement_add(&user_placement,
+                            ROUND_UP((uint64_t)memory_region[i].start, PAGE_BITS),
+                            ROUND_DOWN((uint64_t)memory_region[i].end, PAGE_BITS));
+        if (0 != ret) {
+            return -1;
+        }
+    }
+
+    ret = placement_reserve(&user_placement,
+                            ROUND_DOWN((uint64_t)(uintptr_t)_text, PAGE_BITS),
+                            ROUND_UP((uint64_t)(uintptr_t)_end, PAGE_BITS));
+    if (0 != ret) {
+        return -1;
+    }
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    ret = placement_reserve(&user_placement, WARM_BOOT_RECORD_PADDR,
+                            WARM_BOOT_RECORD_PADDR + BIT(PAGE_BITS));
+    if (0 != ret) {
+        return -1;
+    }
+#endif
+
+    return placement_reserve(&user_placement, used_start, used_end);
+}
+
+#endif /* CONFIG_ELFLOADER_ROOTSERVERS_LAST */
+
+/* The user image each node starts, nodes past the end start the last one. */
+static unsigned int const node_user_image[] = {
+    CONFIG_ELFLOADER_ROOTSERVER_NODE_MAP
+};
+
+unsigned int get_node_user_image(unsigned int node)
+{
+    if (node >= ARRAY_SIZE(node_user_image)) {
+        node = ARRAY_SIZE(node_user_image) - 1;
+    }
+    return node_user_image[node];
+}
+
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+
+/* The load plan from the archive, NULL if there is none. */
+static struct load_plan_header const *load_plan;
+
+/*
+ * Get the load plan entry for an archive member. Returns NULL if there is no
+ * plan or it does not cover the member, the ELF file is parsed then.
+ */
+static struct load_plan_image const *get_plan_image(
+    char const *name,
+    uint32_t type)
+{
+    if (!load_plan) {
+        return NULL;
+    }
+
+    struct load_plan_image const *image = load_plan_get_image(load_plan, name);
+    if (image && (image->type != type)) {
+        printf("WARNING: load plan entry for '%s' has wrong type %u\n",
+               name, image->type);
+        return NULL;
+    }
+
+    return image;
+}
+
+#else /* not CONFIG_ELFLOADER_LOAD_PLAN */
+
+/* Without load plan support there is just an opaque placeholder type. */
+struct load_plan_image;
+
+#endif /* [not] CONFIG_ELFLOADER_LOAD_PLAN */
+
 /*
  * Determine if two intervals overlap.
  */
@@ -87,70 +208,481 @@ static int ensure_phys_range_valid(
         return -1;
     }
 
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    if (regions_overlap(paddr_min,
+                        paddr_max - 1,
+                        WARM_BOOT_RECORD_PADDR,
+                        WARM_BOOT_RECORD_PADDR + BIT(PAGE_BITS) - 1)) {
+        printf("ERROR: image load address overlaps with load record!\n");
+        return -1;
+    }
+#endif
+
     return 0;
 }
 
 /*
- * Unpack an ELF file to the given physical address.
+ * Check whether the DTB can be handed over where it is. It must be page aligned
+ * and must not overlap with the ELF-loader, which the kernel may use as free
+ * memory, or with anything that gets loaded. A DTB from the archive is always
+ * in the ELF-loader.
  */
-static int unpack_elf_to_paddr(
-    void const *elf,
+static int is_dtb_usable_in_place(
+    void const *dtb,
+    size_t dtb_size,
+    paddr_t kernel_phys_start,
+    paddr_t kernel_phys_end)
+{
+    uintptr_t start = (uintptr_t)dtb;
+    uintptr_t end = start + dtb_size;
+
+    if (!IS_ALIGNED(start, PAGE_BITS) || (end < start) ||
+        regions_overlap(start, end - 1, (uintptr_t)_text, (uintptr_t)_end - 1)) {
+        return 0;
+    }
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    if (regions_overlap(start, end - 1, WARM_BOOT_RECORD_PADDR,
+                        WARM_BOOT_RECORD_PADDR + BIT(PAGE_BITS) - 1)) {
+        return 0;
+    }
+#endif
+
+#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
+    /* The user images are placed around it. */
+    return !regions_overlap(start, end - 1, kernel_phys_start,
+                            ROUND_UP(kernel_phys_end, PAGE_BITS) - 1);
+#else
+    /* The user images are placed right after the kernel. */
+    UNUSED_VARIABLE(kernel_phys_end);
+    return end <= kernel_phys_start;
+#endif
+}
+
+/*
+ * Copy the part of the ELF file at [offset..offset+len), which is at 'src', to
+ * all loadable segments that contain it. Code that runs on a worker must not
+ * queue jobs itself, it clears 'use_workers'.
+ */
+static void copy_file_chunk_to_segments(
+    struct elf_view const *elf,
+    paddr_t dest_paddr,
+    size_t offset,
+    size_t len,
+    void const *src,
+    int use_workers)
+{
+    struct elf_segment seg;
+
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        size_t seg_offset = (size_t)seg.offset;
+        if ((offset < seg_offset) || (offset - seg_offset >= seg.file_size)) {
+            continue;
+        }
+
+        /* The caller never passes a chunk that crosses a segment boundary. */
+        paddr_t chunk_dest_paddr = dest_paddr
+                                   + (vaddr_t)(seg.vaddr - elf->min_vaddr)
+                                   + (offset - seg_offset);
+        if ((void const *)chunk_dest_paddr == src) {
+            continue;
+        }
+        if (use_workers) {
+            workers_memcpy((void *)chunk_dest_paddr, src, len);
+        } else {
+            memcpy((void *)chunk_dest_paddr, src, len);
+        }
+    }
+}
+
+/*
+ * Get the end of the run starting at 'pos' in which the set of loadable
+ * segments that contain the file data does not change. 'is_loaded' is set if
+ * the run belongs to any segment.
+ */
+static size_t get_file_run_end(
+    struct elf_view const *elf,
+    size_t pos,
+    int *is_loaded)
+{
+    struct elf_segment seg;
+    size_t run_end = elf->file_size;
+    *is_loaded = 0;
+
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        size_t seg_offset = (size_t)seg.offset;
+        size_t seg_end = seg_offset + (size_t)seg.file_size;
+        if (seg_offset == seg_end) {
+            continue;
+        }
+        if (seg_offset > pos) {
+            run_end = MIN(run_end, seg_offset);
+        } else if (seg_end > pos) {
+            *is_loaded = 1;
+            run_end = MIN(run_end, seg_end);
+        }
+    }
+
+    return run_end;
+}
+
+/*
+ * Walk over the ELF file up to 'end' once in file order. Each chunk is fed into
+ * the hash and, if it belongs to a loadable segment, copied to its destination
+ * in the same step. Parts of the file that are not loaded (headers, gaps,
+ * section tables, debug information) are just hashed. If there are workers,
+ * they get the copying of the whole run, while the boot core hashes it.
+ */
+static void hash_and_copy_elf(
+    struct elf_view const *elf,
+    size_t end,
+    paddr_t dest_paddr,
+    hashes_t *hashes)
+{
+    size_t pos = 0;
+
+    while (pos < end) {
+        int is_loaded;
+        size_t run_end = MIN(get_file_run_end(elf, pos, &is_loaded), end);
+
+        int copy_chunks = is_loaded;
+        if (is_loaded && (workers_online() > 0)) {
+            copy_file_chunk_to_segments(elf, dest_paddr, pos, run_end - pos,
+                                        (void const *)((uintptr_t)elf->file
+                                                       + pos), 1);
+            copy_chunks = 0;
+        }
+
+        while (pos < run_end) {
+            size_t len = MIN(run_end - pos, HASH_CHUNK_SIZE);
+            void const *src = (void const *)((uintptr_t)elf->file + pos);
+            if (copy_chunks) {
+                copy_file_chunk_to_segments(elf, dest_paddr, pos, len, src, 1);
+            }
+            if (hashes) {
+                hash_update(hashes, src, len);
+            }
+            pos += len;
+        }
+    }
+}
+
+#ifdef CONFIG_ELFLOADER_HASH_TREE
+
+struct tree_copy {
+    struct elf_view const *elf;
+    paddr_t dest_paddr;
+};
+
+/*
+ * Copy a chunk of a hash tree leaf that has just been hashed to the segments
+ * that contain it, the rest of the chunk is not loaded. This runs on the
+ * workers.
+ */
+static void copy_tree_chunk(
+    void *arg,
+    size_t offset,
+    size_t len,
+    void const *src)
+{
+    struct tree_copy const *copy = arg;
+    size_t end = offset + len;
+
+    while (offset < end) {
+        int is_loaded;
+        size_t run_end = MIN(get_file_run_end(copy->elf, offset, &is_loaded),
+                             end);
+        if (is_loaded) {
+            copy_file_chunk_to_segments(copy->elf, copy->dest_paddr, offset,
+                                        run_end - offset, src, 0);
+        }
+        src = (void const *)((uintptr_t)src + (run_end - offset));
+        offset = run_end;
+    }
+}
+
+#endif /* CONFIG_ELFLOADER_HASH_TREE */
+
+#ifdef CONFIG_ELFLOADER_COMPRESSED_ARCHIVE
+
+/*
+ * Get the ELF file from a compressed archive member. The returned pointer is
+ * to the ELF headers, which are stored uncompressed, 'elf_size' is set to the
+ * size of the decompressed ELF file. Returns NULL if the member is not valid.
+ */
+static void const *get_compressed_elf(
+    void const *blob,
+    size_t blob_size,
+    size_t *elf_size)
+{
+    struct compressed_elf_header const *header = blob;
+
+    if ((blob_size < sizeof(*header)) ||
+        (header->magic != COMPRESSED_ELF_MAGIC) ||
+        (header->head_size < sizeof(struct Elf64_Header)) ||
+        (header->head_size > header->file_size) ||
+        (ROUND_UP(header->head_size, 2) > blob_size - sizeof(*header))) {
+        printf("ERROR: invalid compressed ELF file\n");
+        return NULL;
+    }
+
+    /* Everything that is parsed before decompression must be in the head. */
+    void const *elf = header + 1;
+    struct elf_view head;
+    if (0 != elf_view_init(&head, elf, header->head_size)) {
+        printf("ERROR: compressed ELF file has invalid headers\n");
+        return NULL;
+    }
+
+    /* Check the block table once, so decompression can rely on it. */
+    size_t pos = header->head_size;
+    size_t offset = sizeof(*header) + ROUND_UP(header->head_size, 2);
+    for (unsigned int i = 0; i < header->num_blocks; i++) {
+        if (sizeof(struct compressed_elf_block) > blob_size - offset) {
+            printf("ERROR: compressed ELF file truncated\n");
+            return NULL;
+        }
+        struct compressed_elf_block const *block =
+            (void const *)((uintptr_t)blob + offset);
+        offset += sizeof(*block);
+        size_t data_size = block->data_size & ~COMPRESSED_ELF_STORED;
+        if ((ROUND_UP(data_size, 2) > blob_size - offset) ||
+            (block->size > header->file_size - pos) ||
+            ((block->data_size & COMPRESSED_ELF_STORED) &&
+             (data_size != block->size))) {
+            printf("ERROR: compressed ELF file block %u invalid\n", i);
+            return NULL;
+        }
+        offset += ROUND_UP(data_size, 2);
+        pos += block->size;
+    }
+    if (pos != header->file_size) {
+        printf("ERROR: compressed ELF file blocks don't match size\n");
+        return NULL;
+    }
+
+    *elf_size = header->file_size;
+    return elf;
+}
+
+/*
+ * Decompress the data of a compressed ELF file that get_compressed_elf() has
+ * checked straight to the destination of the loadable segments. If 'hashes' is
+ * not NULL, all of the decompressed ELF file is fed into it.
+ */
+static int decompress_elf(
+    struct elf_view const *elf,
+    paddr_t dest_paddr,
+    hashes_t *hashes)
+{
+    static uint8_t scratch[COMPRESSED_ELF_SCRATCH_SIZE];
+
+    /* The header is right before the ELF headers. */
+    struct compressed_elf_header const *header =
+        (void const *)((uintptr_t)elf->file - sizeof(*header));
+    size_t pos = header->head_size;
+
+    /* The head is stored uncompressed and may be part of a segment, too. */
+    hash_and_copy_elf(elf, pos, dest_paddr, hashes);
+
+    uintptr_t next = (uintptr_t)elf->file + ROUND_UP(pos, 2);
+    for (unsigned int i = 0; i < header->num_blocks; i++) {
+        struct compressed_elf_block const *block = (void const *)next;
+        void const *data = block + 1;
+        size_t data_size = block->data_size & ~COMPRESSED_ELF_STORED;
+        size_t size = block->size;
+        next = (uintptr_t)data + ROUND_UP(data_size, 2);
+
+        int is_loaded;
+        if (get_file_run_end(elf, pos, &is_loaded) - pos < size) {
+            printf("ERROR: compressed block %u crosses segment\n", i);
+            return -1;
+        }
+
+        /* Decompress to the first segment that contains the block, then copy
+         * it to all others. Data that is not loaded just gets hashed.
+         */
+        uint8_t *dest = NULL;
+        if (is_loaded) {
+            struct elf_segment seg;
+            for (unsigned int j = 0; elf_view_next_load_segment(elf, &j, &seg);
+                 j++) {
+                size_t seg_offset = (size_t)seg.offset;
+                if ((pos >= seg_offset) && (pos - seg_offset < seg.file_size)) {
+                    dest = (uint8_t *)(dest_paddr
+                                       + (vaddr_t)(seg.vaddr - elf->min_vaddr)
+                                       + (pos - seg_offset));
+                    break;
+                }
+            }
+        } else if (hashes) {
+            if (size > sizeof(scratch)) {
+                printf("ERROR: compressed block %u too large\n", i);
+                return -1;
+            }
+            dest = scratch;
+        }
+
+        if (dest) {
+            if (block->data_size & COMPRESSED_ELF_STORED) {
+                memcpy(dest, data, size);
+            } else if (0 != lz4_decompress_block(dest, size, data, data_size)) {
+                printf("ERROR: decompressing block %u failed\n", i);
+                return -1;
+            }
+            if (is_loaded) {
+                copy_file_chunk_to_segments(elf, dest_paddr, pos, size, dest,
+                                            1);
+            }
+            if (hashes) {
+                hash_update(hashes, dest, size);
+            }
+        }
+
+        pos += size;
+    }
+
+    return 0;
+}
+
+#endif /* CONFIG_ELFLOADER_COMPRESSED_ARCHIVE */
+
+#if !defined(CONFIG_ELFLOADER_PREZEROED_RAM) || \
+    defined(CONFIG_ELFLOADER_WARM_BOOT)
+
+/*
+ * Zero all parts of [min_vaddr..min_vaddr+image_size) that are not backed by
+ * data from the ELF file, i.e. gaps between segments, the part of a segment
+ * that is larger in memory than in the file (usually the BSS) and the padding
+ * up to the end of the image. Everything else gets overwritten with data from
+ * the ELF file anyway, so there is no need to zero it first. Returns the number
+ * of bytes zeroed.
+ */
+static size_t zero_unbacked_ranges(
+    struct elf_view const *elf,
+    size_t image_size,
     paddr_t dest_paddr)
 {
-    int ret;
+    struct elf_segment seg;
+    vaddr_t min_vaddr = (vaddr_t)elf->min_vaddr;
+    vaddr_t pos = min_vaddr;
+    vaddr_t end = min_vaddr + image_size;
+    size_t zeroed = 0;
+
+    while (pos < end) {
+        /* Find the end of the range starting at 'pos' that is either fully
+         * backed by segment data or not backed at all.
+         */
+        vaddr_t range_end = end;
+        int is_backed = 0;
+        for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg);
+             i++) {
+            vaddr_t seg_start = (vaddr_t)seg.vaddr;
+            vaddr_t seg_end = seg_start + (size_t)seg.file_size;
+            if (seg_start == seg_end) {
+                continue;
+            }
+            if (seg_start > pos) {
+                range_end = MIN(range_end, seg_start);
+            } else if (seg_end > pos) {
+                is_backed = 1;
+                range_end = MIN(range_end, seg_end);
+            }
+        }
 
-    /* Get the memory bounds. Unlike most other functions, this returns 1 on
-     * success and anything else is an error.
-     */
-    uint64_t u64_min_vaddr, u64_max_vaddr;
-    ret = elf_getMemoryBounds(elf, 0, &u64_min_vaddr, &u64_max_vaddr);
-    if (ret != 1) {
-        printf("ERROR: Could not get image size\n");
-        return -1;
+        if (!is_backed) {
+            workers_memset((void *)(dest_paddr + (pos - min_vaddr)), 0,
+                           range_end - pos);
+            zeroed += range_end - pos;
+        }
+        pos = range_end;
     }
 
+    return zeroed;
+}
+
+#endif /* not CONFIG_ELFLOADER_PREZEROED_RAM or CONFIG_ELFLOADER_WARM_BOOT */
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+
+/*
+ * Copy the writable segments of an image that is otherwise still in memory
+ * from the previous boot.
+ */
+static void reload_writable_segments(
+    struct elf_view const *elf,
+    paddr_t dest_paddr)
+{
+    struct elf_segment seg;
+
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        if (!(seg.flags & PF_W)) {
+            continue;
+        }
+
+        workers_memcpy((void *)(dest_paddr
+                                + (vaddr_t)(seg.vaddr - elf->min_vaddr)),
+                       (void const *)((uintptr_t)elf->file
+                                      + (size_t)seg.offset),
+                       (size_t)seg.file_size);
+    }
+}
+
+#endif /* CONFIG_ELFLOADER_WARM_BOOT */
+
+/*
+ * Unpack an ELF file to the given physical address. If 'hashes' is not NULL,
+ * the whole ELF file is fed into it while the segments are copied. If 'tree'
+ * is not NULL, each leaf of the ELF file is checked while it is copied.
+ */
+static int unpack_elf_to_paddr(
+    struct elf_view const *elf,
+    paddr_t dest_paddr,
+    hashes_t *hashes,
+    struct hash_tree const *tree)
+{
+    struct elf_segment seg;
+    size_t elf_size = elf->file_size;
+
     /* Check that image virtual address range is sane */
-    if ((u64_min_vaddr > UINTPTR_MAX) || (u64_max_vaddr > UINTPTR_MAX)) {
+    if ((elf->min_vaddr > UINTPTR_MAX) || (elf->max_vaddr > UINTPTR_MAX)) {
         printf("ERROR: image virtual address [%"PRIu64"..%"PRIu64"] exceeds "
                "UINTPTR_MAX (%u)\n",
-               u64_min_vaddr, u64_max_vaddr, UINTPTR_MAX);
+               elf->min_vaddr, elf->max_vaddr, UINTPTR_MAX);
         return -1;
     }
 
-    vaddr_t max_vaddr = (vaddr_t)u64_max_vaddr;
-    vaddr_t min_vaddr = (vaddr_t)u64_min_vaddr;
+    vaddr_t max_vaddr = (vaddr_t)elf->max_vaddr;
+    vaddr_t min_vaddr = (vaddr_t)elf->min_vaddr;
     size_t image_size = max_vaddr - min_vaddr;
+    /* The image occupies memory up to the end of the last page. */
+    size_t padded_image_size = ROUND_UP(max_vaddr, PAGE_BITS) - min_vaddr;
 
-    if (dest_paddr + image_size < dest_paddr) {
+    if ((padded_image_size < image_size) ||
+        (dest_paddr + padded_image_size < dest_paddr)) {
         printf("ERROR: image destination address integer overflow\n");
         return -1;
     }
 
-    /* Zero out all memory in the region, as the ELF file may be sparse. */
-    memset((void *)dest_paddr, 0, image_size);
-
-    /* Load each segment in the ELF file. */
-    for (unsigned int i = 0; i < elf_getNumProgramHeaders(elf); i++) {
-        /* Skip segments that are not marked as being loadable. */
-        if (elf_getProgramHeaderType(elf, i) != PT_LOAD) {
-            continue;
+    /* Check all loadable segments before anything is written to memory. */
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        if ((seg.vaddr > UINTPTR_MAX) || (seg.file_size > UINTPTR_MAX) ||
+            (seg.offset > UINTPTR_MAX)) {
+            printf("ERROR: segement %d invalid\n", i);
+            return -1;
         }
-
-        /* Parse size/length headers. */
-        vaddr_t seg_vaddr = elf_getProgramHeaderVaddr(elf, i);
-        size_t seg_size = elf_getProgramHeaderFileSize(elf, i);
-        size_t seg_elf_offset = elf_getProgramHeaderOffset(elf, i);
+        vaddr_t seg_vaddr = (vaddr_t)seg.vaddr;
+        size_t seg_size = (size_t)seg.file_size;
+        size_t seg_elf_offset = (size_t)seg.offset;
 
         size_t seg_virt_offset = seg_vaddr - min_vaddr;
         paddr_t seg_dest_paddr = dest_paddr + seg_virt_offset;
-        void const *seg_src_addr = (void const *)((uintptr_t)elf +
-                                                  seg_elf_offset);
 
         /* Check segment sanity and integer overflows. */
         if ((seg_vaddr < min_vaddr) ||
             (seg_size > image_size) ||
-            (seg_src_addr < elf) ||
-            ((uintptr_t)seg_src_addr + seg_size < (uintptr_t)elf) ||
+            (seg_elf_offset > elf_size) ||
+            (seg_size > elf_size - seg_elf_offset) ||
             (seg_virt_offset > image_size) ||
             (seg_virt_offset + seg_size > image_size) ||
             (seg_dest_paddr < dest_paddr) ||
@@ -158,49 +690,193 @@ static int unpack_elf_to_paddr(
             printf("ERROR: segement %d invalid\n", i);
             return -1;
         }
+    }
+
+#ifdef CONFIG_ELFLOADER_PREZEROED_RAM
+    /* The firmware hands over zeroed memory, so whatever the ELF file does not
+     * provide data for is zero already.
+     */
+    UNUSED_VARIABLE(padded_image_size);
+#else
+    /* The ELF file may be sparse, zero what does not get overwritten. */
+    int ts = timestamp_begin(TIMESTAMP_ZERO);
+    size_t zeroed = zero_unbacked_ranges(elf, padded_image_size, dest_paddr);
+    timestamp_end(ts, zeroed);
+#endif
+
+#ifndef CONFIG_ELFLOADER_HASH_TREE
+    UNUSED_VARIABLE(tree);
+#endif
+
+    int ts_copy = timestamp_begin(TIMESTAMP_COPY);
+#ifdef CONFIG_ELFLOADER_COMPRESSED_ARCHIVE
+    /* All data comes from the compressed blocks. */
+    int ret = decompress_elf(elf, dest_paddr, hashes);
+    timestamp_end(ts_copy, elf_size);
+    return ret;
+#else
+#ifdef CONFIG_ELFLOADER_HASH_TREE
+    if (tree) {
+        /* The workers copy each chunk of a leaf right after hashing it, so
+         * the file is read once. A bad leaf stops the load, but the leaves
+         * before it may have been copied already.
+         */
+        struct tree_copy copy = { .elf = elf, .dest_paddr = dest_paddr };
+        int ret = hash_tree_verify(tree, elf->file, copy_tree_chunk, &copy);
+        timestamp_end(ts_copy, elf_size);
+        return ret;
+    }
+#endif
+    if (hashes) {
+        hash_and_copy_elf(elf, elf_size, dest_paddr, hashes);
+        timestamp_end(ts_copy, elf_size);
+        return 0;
+    }
+
+    /* Load each segment in the ELF file. */
+    size_t copied = 0;
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        paddr_t seg_dest_paddr = dest_paddr + ((vaddr_t)seg.vaddr - min_vaddr);
+        void const *seg_src_addr = (void const *)((uintptr_t)elf->file +
+                                                  (size_t)seg.offset);
 
         /* Load data into memory. */
-        memcpy((void *)seg_dest_paddr, seg_src_addr, seg_size);
+        workers_memcpy((void *)seg_dest_paddr, seg_src_addr,
+                       (size_t)seg.file_size);
+        copied += (size_t)seg.file_size;
+    }
+
+    timestamp_end(ts_copy, copied);
+    return 0;
+#endif /* [not] CONFIG_ELFLOADER_COMPRESSED_ARCHIVE */
+}
+
+#ifdef CONFIG_ELFLOADER_KERNEL_PREPOSITIONED
+
+/*
+ * The build has placed the data of all loadable segments at their final
+ * physical address already, the ELF file in the archive has just the headers.
+ * Check that the payload matches the headers, zero everything that is not
+ * backed by the payload and hash the payload in place.
+ */
+static int verify_prepositioned_elf(
+    struct elf_view const *elf,
+    paddr_t dest_paddr,
+    hashes_t *hashes)
+{
+    struct elf_segment seg;
+
+    paddr_t payload_start = (paddr_t)_kernel_payload_start;
+    paddr_t payload_end = (paddr_t)_kernel_payload_end;
+    if (dest_paddr != payload_start) {
+        printf("ERROR: payload at %p, but image must be at %p\n",
+               payload_start, dest_paddr);
+        return -1;
+    }
+
+    if ((elf->min_vaddr > UINTPTR_MAX) || (elf->max_vaddr > UINTPTR_MAX)) {
+        printf("ERROR: image virtual address [%"PRIu64"..%"PRIu64"] exceeds "
+               "UINTPTR_MAX (%u)\n",
+               elf->min_vaddr, elf->max_vaddr, UINTPTR_MAX);
+        return -1;
+    }
+
+    vaddr_t min_vaddr = (vaddr_t)elf->min_vaddr;
+    size_t padded_image_size = ROUND_UP((vaddr_t)elf->max_vaddr, PAGE_BITS)
+                               - min_vaddr;
+    if ((payload_end < payload_start) ||
+        (payload_end - payload_start > padded_image_size)) {
+        printf("ERROR: payload larger than image\n");
+        return -1;
+    }
+
+    /* Every byte of segment data must come from the payload. */
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        vaddr_t seg_vaddr = (vaddr_t)seg.vaddr;
+        size_t seg_size = (size_t)seg.file_size;
+        size_t seg_virt_offset = seg_vaddr - min_vaddr;
+        if ((seg.vaddr > UINTPTR_MAX) || (seg.file_size > UINTPTR_MAX) ||
+            (seg_vaddr < min_vaddr) ||
+            (seg_virt_offset > payload_end - payload_start) ||
+            (seg_size > payload_end - payload_start - seg_virt_offset)) {
+            printf("ERROR: segement %d not in payload\n", i);
+            return -1;
+        }
+    }
+
+#ifndef CONFIG_ELFLOADER_PREZEROED_RAM
+    zero_unbacked_ranges(elf, padded_image_size, dest_paddr);
+#endif
+
+    if (hashes) {
+        for (paddr_t pos = payload_start; pos < payload_end;
+             pos += HASH_CHUNK_SIZE) {
+            hash_update(hashes, (void const *)pos,
+                        MIN(payload_end - pos, HASH_CHUNK_SIZE));
+        }
     }
 
     return 0;
 }
 
+#endif /* CONFIG_ELFLOADER_KERNEL_PREPOSITIONED */
+
 /*
- * Load an ELF file into physical memory at the given physical address.
+ * Load an ELF file into physical memory at the given physical address. If
+ * 'plan_image' is not NULL, the precomputed load plan is used instead of
+ * parsing the ELF file and 'elf' is NULL, otherwise 'elf' is the view of the
+ * ELF file at 'elf_blob'. If 'is_prepositioned' is set, the data is at the
+ * given physical address already and only gets verified.
  *
  * Returns in 'next_phys_addr' the byte past the last byte of the physical
  * address used.
  */
 static int load_elf(
-    void const *cpio,
-    size_t cpio_len,
     const char *name,
+    struct elf_view const *elf,
     void const *elf_blob,
     size_t elf_blob_size,
     char const *elf_hash_filename,
+    struct load_plan_image const *plan_image,
     paddr_t dest_paddr,
+    int is_prepositioned,
     int keep_headers,
     struct image_info *info,
     paddr_t *next_phys_addr)
 {
     int ret;
     uint64_t min_vaddr, max_vaddr;
+    vaddr_t virt_entry;
 
     /* Print diagnostics. */
     printf("ELF-loading image '%s' to %p\n", name, dest_paddr);
 
-    /* Get the memory bounds. Unlike most other functions, this returns 1 on
-     * success and anything else is an error.
-     */
-    ret = elf_getMemoryBounds(elf_blob, 0, &min_vaddr, &max_vaddr);
-    if (ret != 1) {
-        printf("ERROR: Could not get image bounds\n");
-        return -1;
+    timestamp_image(name);
+    int ts = timestamp_begin(TIMESTAMP_LOOKUP);
+
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+    if (plan_image) {
+        if (plan_image->file_size != elf_blob_size) {
+            printf("ERROR: load plan does not match image size\n");
+            return -1;
+        }
+        /* The plan has the bounds rounded up to the next page already. */
+        min_vaddr = plan_image->virt_start;
+        max_vaddr = plan_image->virt_end;
+        virt_entry = (vaddr_t)plan_image->virt_entry;
+    } else
+#else
+    UNUSED_VARIABLE(elf_blob);
+    UNUSED_VARIABLE(elf_blob_size);
+    UNUSED_VARIABLE(plan_image);
+#endif
+    {
+        min_vaddr = elf->min_vaddr;
+        /* round up size to the end of the page next page */
+        max_vaddr = ROUND_UP(elf->max_vaddr, PAGE_BITS);
+        virt_entry = (vaddr_t)elf->entry;
     }
 
-    /* round up size to the end of the page next page */
-    max_vaddr = ROUND_UP(max_vaddr, PAGE_BITS);
     size_t image_size = (size_t)(max_vaddr - min_vaddr);
 
     /* Ensure our starting physical address is aligned. */
@@ -218,78 +894,110 @@ static int load_elf(
 
 #ifdef CONFIG_HASH_NONE
 
-    UNUSED_VARIABLE(cpio);
-    UNUSED_VARIABLE(cpio_len);
-    UNUSED_VARIABLE(elf_blob_size);
     UNUSED_VARIABLE(elf_hash_filename);
+    hashes_t *hashes = NULL;
 
 #else
 
-    /* Get the binary file that contains the Hash */
-    unsigned long cpio_file_size = 0;
-    void const *file_hash = cpio_get_file(cpio,
-                                          cpio_len,
-                                          elf_hash_filename,
-                                          &cpio_file_size);
+    void const *file_hash;
+    size_t file_hash_len;
+
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+    if (plan_image) {
+        /* The load plan carries the expected hash. */
+        file_hash = plan_image->hash;
+        file_hash_len = sizeof(plan_image->hash);
+    } else
+#endif
+    {
+        /* Get the binary file that contains the Hash */
+        file_hash = cpio_index_get_file(elf_hash_filename, &file_hash_len);
 
-    /* If the file hash doesn't have a pointer, the file doesn't exist, so we
-     * cannot confirm the file is what we expect.
+        /* If the file hash doesn't have a pointer, the file doesn't exist, so
+         * we cannot confirm the file is what we expect.
+         */
+        if (file_hash == NULL) {
+            printf("ERROR: hash file '%s' doesn't exist\n", elf_hash_filename);
+            return -1;
+        }
+    }
+
+#ifdef CONFIG_ELFLOADER_SEGMENT_DIGESTS
+
+    /* The loaded segments are checked after copying, the ELF file itself is
+     * not hashed.
      */
-    if (file_hash == NULL) {
-        printf("ERROR: hash file '%s' doesn't exist\n", elf_hash_filename);
+    struct segment_digests const *digests =
+        segment_digests_load(file_hash, file_hash_len, elf);
+    if (!digests) {
+        printf("ERROR: segment digests '%s' do not match ELF file\n",
+               elf_hash_filename);
         return -1;
     }
+    hashes_t *hashes = NULL;
 
-    /* Ensure we can safely cast the CPIO API type to our preferred type. */
-    _Static_assert(sizeof(cpio_file_size) <= sizeof(size_t),
-                   "integer model mismatch");
-    size_t file_hash_len = (size_t)cpio_file_size;
+#elif defined(CONFIG_ELFLOADER_HASH_TREE)
 
-#ifdef CONFIG_HASH_SHA
-    uint8_t calculated_hash[32];
-    hashes_t hashes = { .hash_type = SHA_256 };
-#else
-    uint8_t calculated_hash[16];
-    hashes_t hashes = { .hash_type = MD5 };
+    /* The file is checked leaf by leaf while it is unpacked below, instead
+     * of being fed into a single hash. A pre-positioned kernel is checked in
+     * place here.
+     */
+    size_t tree_data_size = elf_blob_size;
+#ifdef CONFIG_ELFLOADER_KERNEL_PREPOSITIONED
+    if (is_prepositioned) {
+        tree_data_size = _kernel_payload_end - _kernel_payload_start;
+    }
+#endif
+    struct hash_tree const *tree = hash_tree_get(file_hash, file_hash_len,
+                                                 tree_data_size);
+    if (!tree) {
+        printf("ERROR: hash tree '%s' does not match ELF file\n",
+               elf_hash_filename);
+        return -1;
+    }
+#ifdef CONFIG_ELFLOADER_KERNEL_PREPOSITIONED
+    if (is_prepositioned) {
+        /* The rest of the lookup is quick, only the hashing is timed here. */
+        timestamp_end(ts, 0);
+        ts = timestamp_begin(TIMESTAMP_HASH);
+        ret = hash_tree_verify(tree, _kernel_payload_start, NULL, NULL);
+        timestamp_end(ts, tree_data_size);
+        ts = -1;
+        if (0 != ret) {
+            printf("ERROR: Hashes are different\n");
+            return -1;
+        }
+    }
 #endif
+    hashes_t *hashes = NULL;
+
+#else /* hash of the whole file */
+
+    uint8_t calculated_hash[HASH_CONFIG_LEN];
+    hashes_t hash_state = { .hash_type = HASH_CONFIG_TYPE };
+    hashes_t *hashes = &hash_state;
 
     if (file_hash_len < sizeof(calculated_hash)) {
         printf("ERROR: hash file '%s' size %u invalid, expected at least %u\n",
                elf_hash_filename, file_hash_len, sizeof(calculated_hash));
+        return -1;
     }
 
     /* Print the Hash for the user to see */
     printf("Hash from ELF File: ");
     print_hash(file_hash, sizeof(calculated_hash));
 
-    get_hash(hashes, elf_blob, elf_blob_size, calculated_hash);
+    /* The ELF file is hashed while it is unpacked below. */
+    hash_init(hashes);
 
-    /* Print the hash so the user can see they're the same or different */
-    printf("Hash for ELF Input: ");
-    print_hash(calculated_hash, sizeof(calculated_hash));
-
-    /* Check the hashes are the same. There is no memcmp() in the striped down
-     * runtime lib of ELF Loader, so we compare here byte per byte. */
-    for (unsigned int i = 0; i < sizeof(calculated_hash); i++) {
-        if (((char const *)file_hash)[i] != ((char const *)calculated_hash)[i]) {
-            printf("ERROR: Hashes are different\n");
-            return -1;
-        }
-    }
+#endif /* segment digests, hash tree or hash of the whole file */
 
 #endif  /* CONFIG_HASH_NONE */
 
     /* Print diagnostics. */
     printf("  paddr=[%p..%p]\n", dest_paddr, dest_paddr + image_size - 1);
     printf("  vaddr=[%p..%p]\n", (vaddr_t)min_vaddr, (vaddr_t)max_vaddr - 1);
-    printf("  virt_entry=%p\n", (vaddr_t)elf_getEntryPoint(elf_blob));
-
-    /* Ensure the ELF file is valid. */
-    ret = elf_checkFile(elf_blob);
-    if (0 != ret) {
-        printf("ERROR: Invalid ELF file\n");
-        return -1;
-    }
+    printf("  virt_entry=%p\n", virt_entry);
 
     /* Ensure sane alignment of the image. */
     if (!IS_ALIGNED(min_vaddr, PAGE_BITS)) {
@@ -304,19 +1012,123 @@ static int load_elf(
         return -1;
     }
 
-    /* Copy the data. */
-    ret = unpack_elf_to_paddr(elf_blob, dest_paddr);
+    timestamp_end(ts, 0);
+
+    /* Copy the data. If hashing is enabled, the whole ELF file is hashed in
+     * the same pass.
+     */
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    /* Images from a load plan or prepositioned are fast already. */
+    int is_reused = 0;
+    if (!plan_image && !is_prepositioned) {
+        ts = timestamp_begin(TIMESTAMP_HASH);
+        is_reused = (0 == warm_boot_check_image(elf, file_hash,
+                                                sizeof(calculated_hash),
+                                                dest_paddr, image_size));
+        timestamp_end(ts, 0);
+    }
+    if (is_reused) {
+        printf("  reusing image loaded by previous boot\n");
+        ts = timestamp_begin(TIMESTAMP_COPY);
+        reload_writable_segments(elf, dest_paddr);
+        timestamp_end(ts, 0);
+        /* The previous run has left its data there, even if the RAM was
+         * handed over zeroed at the first boot.
+         */
+        ts = timestamp_begin(TIMESTAMP_ZERO);
+        size_t zeroed = zero_unbacked_ranges(elf, image_size, dest_paddr);
+        timestamp_end(ts, zeroed);
+    } else
+#endif
+#ifdef CONFIG_ELFLOADER_KERNEL_PREPOSITIONED
+    if (is_prepositioned) {
+        /* The payload is hashed and the rest zeroed in place. */
+        ts = timestamp_begin(TIMESTAMP_HASH);
+        ret = verify_prepositioned_elf(elf, dest_paddr, hashes);
+        timestamp_end(ts, image_size);
+        if (0 != ret) {
+            printf("ERROR: Verifying image at %p failed\n", dest_paddr);
+            return -1;
+        }
+    } else
+#else
+    UNUSED_VARIABLE(is_prepositioned);
+#endif
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+    if (plan_image) {
+        ts = timestamp_begin(TIMESTAMP_COPY);
+        load_plan_run_image(load_plan, plan_image, elf_blob, dest_paddr,
+                            hashes);
+        timestamp_end(ts, elf_blob_size);
+    } else
+#endif
+    {
+#ifndef CONFIG_ELFLOADER_HASH_TREE
+        struct hash_tree const *tree = NULL;
+#endif
+        ret = unpack_elf_to_paddr(elf, dest_paddr, hashes, tree);
+        if (0 != ret) {
+            printf("ERROR: Unpacking ELF to %p failed\n", dest_paddr);
+            return -1;
+        }
+    }
+
+#if defined(CONFIG_ELFLOADER_SEGMENT_DIGESTS)
+
+    /* The data is checked at its destination. */
+    workers_wait();
+    ts = timestamp_begin(TIMESTAMP_HASH);
+    ret = segment_digests_verify(digests, elf, dest_paddr);
+    timestamp_end(ts, image_size);
     if (0 != ret) {
-        printf("ERROR: Unpacking ELF to %p failed\n", dest_paddr);
+        printf("ERROR: Image at %p does not match segment digests\n",
+               dest_paddr);
         return -1;
     }
 
+#elif !defined(CONFIG_HASH_NONE) && !defined(CONFIG_ELFLOADER_HASH_TREE)
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    /* A reused image has been checked against the load record instead. */
+    if (!is_reused)
+#endif
+    {
+        /* The file was hashed while it was copied, only the end is left. */
+        ts = timestamp_begin(TIMESTAMP_HASH);
+        hash_final(hashes, calculated_hash);
+        timestamp_end(ts, 0);
+
+        /* Print the hash so the user can see they're the same or different */
+        printf("Hash for ELF Input: ");
+        print_hash(calculated_hash, sizeof(calculated_hash));
+
+        /* Check the hashes are the same. The image has already been unpacked
+         * at this point, but it never gets used if the hashes don't match.
+         */
+        if (!hash_is_equal(file_hash, calculated_hash,
+                           sizeof(calculated_hash))) {
+            printf("ERROR: Hashes are different\n");
+            return -1;
+        }
+    }
+
+#endif /* CONFIG_ELFLOADER_SEGMENT_DIGESTS or a hash of the whole file */
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    if (!is_reused && !plan_image && !is_prepositioned) {
+        /* The digests are taken of the data at its destination. */
+        workers_wait();
+        warm_boot_add_image(elf, file_hash, sizeof(calculated_hash),
+                            dest_paddr, image_size);
+    }
+#endif
+
     /* Record information about the placement of the image. */
     info->phys_region_start = dest_paddr;
     info->phys_region_end = dest_paddr + image_size;
     info->virt_region_start = (vaddr_t)min_vaddr;
     info->virt_region_end = (vaddr_t)max_vaddr;
-    info->virt_entry = (vaddr_t)elf_getEntryPoint(elf_blob);
+    info->virt_entry = virt_entry;
     info->phys_virt_offset = dest_paddr - (vaddr_t)min_vaddr;
 
     /* Round up the destination address to the next page */
@@ -324,15 +1136,20 @@ static int load_elf(
 
     if (keep_headers) {
         /* Put the ELF headers in this page */
-        uint32_t phnum = elf_getNumProgramHeaders(elf_blob);
+        uint32_t phnum;
         uint32_t phsize;
         paddr_t source_paddr;
-        if (ISELF32(elf_blob)) {
-            phsize = ((struct Elf32_Header const *)elf_blob)->e_phentsize;
-            source_paddr = (paddr_t)elf32_getProgramHeaderTable(elf_blob);
-        } else {
-            phsize = ((struct Elf64_Header const *)elf_blob)->e_phentsize;
-            source_paddr = (paddr_t)elf64_getProgramHeaderTable(elf_blob);
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+        if (plan_image) {
+            phnum = plan_image->phnum;
+            phsize = plan_image->phentsize;
+            source_paddr = (paddr_t)elf_blob + (size_t)plan_image->phdr_offset;
+        } else
+#endif
+        {
+            phnum = elf->phnum;
+            phsize = elf->phentsize;
+            source_paddr = (paddr_t)elf->phdrs;
         }
         /* We have no way of sharing definitions with the kernel so we just
          * memcpy to a bunch of magic offsets. Explicit numbers for sizes
@@ -348,6 +1165,7 @@ static int load_elf(
     if (next_phys_addr) {
         *next_phys_addr = dest_paddr;
     }
+    timestamp_image(NULL);
     return 0;
 }
 
@@ -390,44 +1208,82 @@ int load_images(
 {
     int ret;
     uint64_t kernel_phys_start, kernel_phys_end;
-    uintptr_t dtb_phys_start, dtb_phys_end;
+    uintptr_t dtb_phys_start = 0, dtb_phys_end = 0;
     paddr_t next_phys_addr;
     const char *elf_filename;
     int has_dtb_cpio = 0;
 
-    void const *cpio = _archive_start;
-    size_t cpio_len = _archive_start_end - _archive_start;
+    struct load_plan_image const *plan_image = NULL;
+
+    int ts = timestamp_begin(TIMESTAMP_LOAD_IMAGES);
+
+    /* All lookups in the archive are served from the index. */
+    ret = cpio_index_init(_archive_start,
+                          _archive_start_end - _archive_start);
+    if (0 != ret) {
+        printf("ERROR: Invalid CPIO archive\n");
+        return -1;
+    }
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    warm_boot_init();
+#endif
+
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+    /* Use the load plan from the archive if there is one, the ELF files
+     * don't have to be parsed then.
+     */
+    int plan_is_invalid;
+    load_plan = load_plan_get(&plan_is_invalid);
+    if (plan_is_invalid) {
+        printf("ERROR: Invalid load plan in archive\n");
+        return -1;
+    }
+    if (!load_plan) {
+        printf("No load plan in archive, parsing ELF files\n");
+    }
+#endif /* CONFIG_ELFLOADER_LOAD_PLAN */
 
     /* Load kernel. */
-    unsigned long cpio_file_size = 0;
-    void const *kernel_elf_blob = cpio_get_file(cpio,
-                                                cpio_len,
-                                                "kernel.elf",
-                                                &cpio_file_size);
+    struct elf_view kernel_elf;
+    size_t kernel_elf_blob_size = 0;
+    void const *kernel_elf_blob = cpio_index_get_file("kernel.elf",
+                                                      &kernel_elf_blob_size);
     if (kernel_elf_blob == NULL) {
         printf("ERROR: No kernel image present in archive\n");
         return -1;
     }
 
-    /* Ensure we can safely cast the CPIO API type to our preferred type. */
-    _Static_assert(sizeof(cpio_file_size) <= sizeof(size_t),
-                   "integer model mismatch");
-    size_t kernel_elf_blob_size = (size_t)cpio_file_size;
-
-    ret = elf_checkFile(kernel_elf_blob);
-    if (ret != 0) {
-        printf("ERROR: Kernel image not a valid ELF file\n");
+#ifdef CONFIG_ELFLOADER_COMPRESSED_ARCHIVE
+    kernel_elf_blob = get_compressed_elf(kernel_elf_blob, kernel_elf_blob_size,
+                                         &kernel_elf_blob_size);
+    if (kernel_elf_blob == NULL) {
+        printf("ERROR: Kernel image not a valid compressed ELF file\n");
         return -1;
     }
+#endif
 
-    /* Get physical memory bounds. Unlike most other functions, this returns 1
-     * on success and anything else is an error.
-     */
-    ret = elf_getMemoryBounds(kernel_elf_blob, 1, &kernel_phys_start,
-                              &kernel_phys_end);
-    if (1 != ret) {
-        printf("ERROR: Could not get kernel memory bounds\n");
-        return -1;
+    /* A pre-positioned kernel is never part of the load plan. */
+#if defined(CONFIG_ELFLOADER_LOAD_PLAN) && \
+    !defined(CONFIG_ELFLOADER_KERNEL_PREPOSITIONED)
+    struct load_plan_image const *kernel_plan_image =
+        get_plan_image("kernel.elf", LOAD_PLAN_IMAGE_KERNEL);
+    if (kernel_plan_image) {
+        kernel_phys_start = kernel_plan_image->phys_start;
+        kernel_phys_end = kernel_plan_image->phys_end;
+    } else
+#else
+    struct load_plan_image const *kernel_plan_image = NULL;
+#endif
+    {
+        ret = elf_view_init(&kernel_elf, kernel_elf_blob, kernel_elf_blob_size);
+        if (ret != 0) {
+            printf("ERROR: Kernel image not a valid ELF file\n");
+            return -1;
+        }
+
+        kernel_phys_start = kernel_elf.min_paddr;
+        kernel_phys_end = kernel_elf.max_paddr;
     }
 
     void const *dtb = NULL;
@@ -443,7 +1299,7 @@ int load_images(
          * devices).  But we are freestanding (on the "bare metal"), and using
          * our own unbuffered printf() implementation.
          */
-        dtb = cpio_get_file(cpio, cpio_len, "kernel.dtb", NULL);
+        dtb = cpio_index_get_file("kernel.dtb", NULL);
         if (dtb == NULL) {
             printf("not found.\n");
         } else {
@@ -461,28 +1317,71 @@ int load_images(
         dtb = bootloader_dtb;
     }
 
-    /*
-     * Move the DTB out of the way, if it's present.
-     */
+    size_t dtb_size = 0;
     if (dtb) {
-        /* keep it page aligned */
-        next_phys_addr = dtb_phys_start = ROUND_UP(kernel_phys_end, PAGE_BITS);
-
-        size_t dtb_size = fdt_size(dtb);
+        dtb_size = fdt_size(dtb);
         if (0 == dtb_size) {
             printf("ERROR: Invalid device tree blob supplied\n");
             return -1;
         }
+    }
+
+    /*
+     * Move the DTB out of the way, if it's present and not somewhere it can
+     * stay.
+     */
+    if (dtb && is_dtb_usable_in_place(dtb, dtb_size, kernel_phys_start,
+                                      kernel_phys_end)) {
+        dtb_phys_start = (paddr_t)dtb;
+        dtb_phys_end = ROUND_UP(dtb_phys_start + dtb_size, PAGE_BITS);
+        next_phys_addr = ROUND_UP(kernel_phys_end, PAGE_BITS);
+
+        printf("Using DTB in place at %p.\n", dtb);
+        *chosen_dtb = (void *)dtb_phys_start;
+        *chosen_dtb_size = dtb_size;
+    } else if (dtb) {
+        /* keep it page aligned */
+        next_phys_addr = dtb_phys_start = ROUND_UP(kernel_phys_end, PAGE_BITS);
 
         /* Make sure this is a sane thing to do */
         ret = ensure_phys_range_valid(next_phys_addr,
-                                      next_phys_addr + dtb_size);
+                                      next_phys_addr + dtb_size +
+                                      TIMESTAMPS_DTB_SPACE);
         if (0 != ret) {
             printf("ERROR: Physical address of DTB invalid\n");
             return -1;
         }
 
-        memmove((void *)next_phys_addr, dtb, dtb_size);
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+        /* The plan has no operations for the DTB, it is packed below. */
+        if (has_dtb_cpio) {
+            plan_image = get_plan_image("kernel.dtb", LOAD_PLAN_IMAGE_DTB);
+        }
+        if (plan_image && (plan_image->file_size != dtb_size)) {
+            printf("ERROR: load plan does not match DTB size\n");
+            return -1;
+        }
+#endif
+
+        /* Drop the free space in the DTB while copying it, unless it overlaps
+         * with its destination.
+         */
+        size_t packed_size = 0;
+        if (!regions_overlap((uintptr_t)dtb, (uintptr_t)dtb + dtb_size - 1,
+                             next_phys_addr, next_phys_addr + dtb_size - 1)) {
+            packed_size = fdt_pack((void *)next_phys_addr, dtb_size, dtb);
+        }
+        if (packed_size) {
+            printf("Packed DTB from %zu to %zu bytes.\n", dtb_size,
+                   packed_size);
+            dtb_size = packed_size;
+        } else {
+            memmove((void *)next_phys_addr, dtb, dtb_size);
+        }
+#ifdef CONFIG_ELFLOADER_BOOT_TIMESTAMPS
+        /* Leave room for adding the boot timestamps before the handover. */
+        dtb_size = fdt_grow((void *)next_phys_addr, TIMESTAMPS_DTB_SPACE);
+#endif
         next_phys_addr += dtb_size;
         next_phys_addr = ROUND_UP(next_phys_addr, PAGE_BITS);
         dtb_phys_end = next_phys_addr;
@@ -496,13 +1395,18 @@ int load_images(
     }
 
     /* Load the kernel */
-    ret = load_elf(cpio,
-                   cpio_len,
-                   "kernel",
+    ret = load_elf("kernel",
+                   kernel_plan_image ? NULL : &kernel_elf,
                    kernel_elf_blob,
                    kernel_elf_blob_size,
                    "kernel.bin", // hash file
+                   kernel_plan_image,
                    (paddr_t)kernel_phys_start,
+#ifdef CONFIG_ELFLOADER_KERNEL_PREPOSITIONED
+                   1, // kernel data is in place already
+#else
+                   0,
+#endif
                    0, // don't keep ELF headers
                    kernel_info,
                    NULL); // we have calculated next_phys_addr already
@@ -517,17 +1421,19 @@ int load_images(
      *
      * We assume (and check) that the kernel is the first file in the archive,
      * that the DTB is the second if present,
-     * and then load the (n+user_elf_offset)'th file in the archive onto the
-     * (n)'th CPU.
+     * and then load the (n+user_elf_offset)'th file in the archive as the
+     * (n)'th user image. Which node starts which image is up to
+     * get_node_user_image(), several nodes can share one image.
      */
     unsigned int user_elf_offset = 2;
-    cpio_get_entry(cpio, cpio_len, 0, &elf_filename, NULL);
+    cpio_index_get_entry(0, &elf_filename, NULL);
     ret = strcmp(elf_filename, "kernel.elf");
     if (0 != ret) {
         printf("ERROR: Kernel image not first image in archive\n");
         return -1;
     }
-    cpio_get_entry(cpio, cpio_len, 1, &elf_filename, NULL);
+    elf_filename = "";
+    cpio_index_get_entry(1, &elf_filename, NULL);
     ret = strcmp(elf_filename, "kernel.dtb");
     if (0 != ret) {
         if (has_dtb_cpio) {
@@ -537,80 +1443,202 @@ int load_images(
         user_elf_offset = 1;
     }
 
+    /*
+     * Place all user images in one pass over their headers, so the whole
+     * layout is known to be usable before anything is copied. Without
+     * CONFIG_ELFLOADER_ROOTSERVERS_LAST they are loaded back to back after the
+     * kernel and the DTB. Otherwise each image goes to the end of the
+     * smallest free memory range it fits in, the address is kept in its
+     * phys_region_start until load_elf() fills in the rest.
+     */
+    size_t total_user_image_size = 0;
+    unsigned int user_image_count = 0;
 #ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
-
-    /* work out the size of the user images - this corresponds to how much
-     * memory load_elf uses */
-    unsigned int total_user_image_size = 0;
-    for (unsigned int i = 0; i < max_user_images; i++) {
-        void const *user_elf = cpio_get_entry(cpio,
-                                              cpio_len,
-                                              i + user_elf_offset,
-                                              NULL,
-                                              NULL);
+    ret = init_user_placement(kernel_phys_start, next_phys_addr);
+    if ((0 == ret) && dtb) {
+        ret = placement_reserve(&user_placement, dtb_phys_start, dtb_phys_end);
+    }
+    if (0 != ret) {
+        printf("ERROR: Could not set up placement of user images\n");
+        return -1;
+    }
+#endif
+    for (unsigned int i = 0; i < MIN(max_user_images,
+                                     ARRAY_SIZE(user_elf_views)); i++) {
+        size_t elf_filesize = 0;
+        void const *user_elf = cpio_index_get_entry(i + user_elf_offset,
+                                                    &elf_filename,
+                                                    &elf_filesize);
         if (user_elf == NULL) {
             break;
         }
-        /* Get the memory bounds. Unlike most other functions, this returns 1 on
-         * success and anything else is an error.
-         */
-        uint64_t min_vaddr, max_vaddr;
-        ret = elf_getMemoryBounds(user_elf, 0, &min_vaddr, &max_vaddr);
-        if (ret != 1) {
-            printf("ERROR: Could not get image bounds\n");
+#ifdef CONFIG_ELFLOADER_COMPRESSED_ARCHIVE
+        user_elf = get_compressed_elf(user_elf, elf_filesize, &elf_filesize);
+        if (user_elf == NULL) {
+            printf("ERROR: User image not a valid compressed ELF file\n");
             return -1;
         }
+#endif
+        uint64_t min_vaddr, max_vaddr;
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+        plan_image = get_plan_image(elf_filename, LOAD_PLAN_IMAGE_USER);
+        if (plan_image) {
+            min_vaddr = plan_image->virt_start;
+            max_vaddr = plan_image->virt_end;
+        } else
+#endif
+        {
+            /* The view is used again when the image is loaded below. */
+            ret = elf_view_init(&user_elf_views[i], user_elf, elf_filesize);
+            if (ret != 0) {
+                printf("ERROR: User image '%s' not a valid ELF file\n",
+                       elf_filename);
+                return -1;
+            }
+            min_vaddr = user_elf_views[i].min_vaddr;
+            max_vaddr = user_elf_views[i].max_vaddr;
+        }
         /* round up size to the end of the page next page */
-        total_user_image_size += (ROUND_UP(max_vaddr, PAGE_BITS) - min_vaddr)
-                                 + KEEP_HEADERS_SIZE;
+        uint64_t image_size = (ROUND_UP(max_vaddr, PAGE_BITS) - min_vaddr)
+                              + KEEP_HEADERS_SIZE;
+#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
+        uint64_t dest;
+        ret = placement_alloc(&user_placement, image_size, PAGE_BITS, &dest);
+        if ((0 != ret) || (dest + image_size - 1 > UINTPTR_MAX)) {
+            printf("ERROR: No space for user image '%s' of %llu bytes\n",
+                   elf_filename, (unsigned long long)image_size);
+            return -1;
+        }
+        user_info[i].phys_region_start = (paddr_t)dest;
+        user_info[i].phys_region_end = (paddr_t)(dest + image_size);
+#endif
+        total_user_image_size += image_size;
+        user_image_count++;
     }
 
-    /* work out where to place the user image */
+    /* Every node's image must be in the archive. */
+    for (unsigned int i = 0; i < ARRAY_SIZE(node_user_image); i++) {
+        if (node_user_image[i] >= user_image_count) {
+            printf("ERROR: node %u needs user image %u, but only %u found\n",
+                   i, node_user_image[i], user_image_count);
+            return -1;
+        }
+    }
 
-    next_phys_addr = ROUND_DOWN(memory_region[0].end, PAGE_BITS)
-                     - ROUND_UP(total_user_image_size, PAGE_BITS);
+#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
 
-#endif /* CONFIG_ELFLOADER_ROOTSERVERS_LAST */
+    printf("Memory map:\n");
+    print_map_entry("ELF-loader", (uintptr_t)_text, (uintptr_t)_end);
+    print_map_entry("kernel", kernel_phys_start, kernel_phys_end);
+    if (dtb) {
+        print_map_entry("DTB", dtb_phys_start, dtb_phys_end);
+    }
+    for (unsigned int i = 0; i < user_image_count; i++) {
+        cpio_index_get_entry(i + user_elf_offset, &elf_filename, NULL);
+        print_map_entry(elf_filename, user_info[i].phys_region_start,
+                        user_info[i].phys_region_end);
+    }
+    for (unsigned int i = 0; i < user_placement.num_ranges; i++) {
+        print_map_entry("free", user_placement.ranges[i].start,
+                        user_placement.ranges[i].end);
+    }
+
+#else /* not CONFIG_ELFLOADER_ROOTSERVERS_LAST */
+
+    ret = ensure_phys_range_valid(next_phys_addr,
+                                  next_phys_addr + total_user_image_size);
+    if (0 != ret) {
+        printf("ERROR: Physical address range of user images invalid\n");
+        return -1;
+    }
+
+#endif /* [not] CONFIG_ELFLOADER_ROOTSERVERS_LAST */
 
     *num_images = 0;
-    for (unsigned int i = 0; i < max_user_images; i++) {
+    for (unsigned int i = 0; i < user_image_count; i++) {
         /* Fetch info about the next ELF file in the archive. */
-        unsigned long cpio_file_size = 0;
-        void const *user_elf = cpio_get_entry(cpio,
-                                              cpio_len,
-                                              i + user_elf_offset,
-                                              &elf_filename,
-                                              &cpio_file_size);
-        if (user_elf == NULL) {
-            break;
+        size_t elf_filesize = 0;
+        void const *user_elf = cpio_index_get_entry(i + user_elf_offset,
+                                                    &elf_filename,
+                                                    &elf_filesize);
+
+#ifdef CONFIG_ELFLOADER_COMPRESSED_ARCHIVE
+        user_elf = get_compressed_elf(user_elf, elf_filesize, &elf_filesize);
+#endif
+
+#ifdef CONFIG_ELFLOADER_LOAD_PLAN
+        plan_image = get_plan_image(elf_filename, LOAD_PLAN_IMAGE_USER);
+#endif
+
+        /* The hash of the first image is in 'app.bin', the one of image n in
+         * 'app<n>.bin'.
+         */
+        char hash_filename[16] = "app.bin";
+        if (i > 0) {
+            hash_filename[sprintf(hash_filename, "app%u.bin", i)] = '\0';
         }
 
-        /* Ensure we can safely cast the CPIO API type to our preferred type. */
-        _Static_assert(sizeof(cpio_file_size) <= sizeof(size_t),
-                       "integer model mismatch");
-        size_t elf_filesize = (size_t)cpio_file_size;
+#ifdef CONFIG_ELFLOADER_ROOTSERVERS_LAST
+        next_phys_addr = user_info[i].phys_region_start;
+#endif
 
         /* Load the file into memory. */
-        ret = load_elf(cpio,
-                       cpio_len,
-                       elf_filename,
+        ret = load_elf(elf_filename,
+                       plan_image ? NULL : &user_elf_views[i],
                        user_elf,
                        elf_filesize,
-                       "app.bin", // hash file
+                       hash_filename,
+                       plan_image,
                        next_phys_addr,
+                       0,  // copy the data from the archive
                        1,  // keep ELF headers
                        &user_info[*num_images],
                        &next_phys_addr);
         if (0 != ret) {
             printf("ERROR: Could not load user image ELF\n");
+            return -1;
         }
 
         *num_images = i + 1;
     }
 
+    /* Everything must be in place before the caller sets up the MMU. */
+    workers_wait();
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+    warm_boot_finish();
+#endif
+
+    timestamp_end(ts, 0);
     return 0;
 }
 
+#ifdef CONFIG_ELFLOADER_CACHED_LOAD
+
+/*
+ * Check whether [start..end) is within one of the platform's memory regions,
+ * partly overlaps with them or does not touch them at all.
+ */
+int get_ram_overlap(uint64_t start, uint64_t end)
+{
+    int ret = RAM_OVERLAP_NONE;
+
+    for (int i = 0; i < num_memory_regions; i++) {
+        uint64_t region_start = memory_region[i].start;
+        uint64_t region_end = memory_region[i].end;
+        if ((start >= region_start) && (end <= region_end)) {
+            return RAM_OVERLAP_FULL;
+        }
+        if ((start < region_end) && (end > region_start)) {
+            ret = RAM_OVERLAP_PARTIAL;
+        }
+    }
+
+    return ret;
+}
+
+#endif /* CONFIG_ELFLOADER_CACHED_LOAD */
+
 /*
  * Platform specific ELF Loader initialization. Can be overwritten.
  */
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <types.h>
+
+/*
+ * With CONFIG_ELFLOADER_COMPRESSED_ARCHIVE, the ELF files in the archive are
+ * compressed by cmake-tool/helpers/compress_elf.py. A compressed ELF file
+ * starts with a compressed_elf_header, followed by the ELF header and program
+ * header table as they are ('head_size' bytes) and then by 'num_blocks'
+ * blocks that cover the rest of the ELF file in order. Each block is a
+ * compressed_elf_block followed by its LZ4 compressed data. Head and block
+ * data are padded to 4 bytes. No block crosses the boundary of a segment's
+ * file data, so each block can be decompressed straight to its destination.
+ * The layout here must be kept in sync with the script.
+ */
+
+#define COMPRESSED_ELF_MAGIC        0x345a4c45 /* "ELZ4" */
+
+/* Set in compressed_elf_block.data_size if the data is stored uncompressed. */
+#define COMPRESSED_ELF_STORED       BIT(31)
+
+/* Blocks of data that is not loaded are at most this size. If hashing is
+ * enabled, they are decompressed to a buffer of this size to hash them.
+ */
+#define COMPRESSED_ELF_SCRATCH_SIZE 4096
+
+/* Archive members are just 4 byte aligned, so there are no 64-bit fields. */
+struct compressed_elf_header {
+    uint32_t magic;
+    uint32_t head_size;
+    uint32_t file_size;     /* size of the decompressed ELF file */
+    uint32_t num_blocks;
+};
+
+struct compressed_elf_block {
+    uint32_t size;          /* decompressed size */
+    uint32_t data_size;     /* size of the data following this header */
+};
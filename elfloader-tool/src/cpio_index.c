@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <types.h>
+#include <strops.h>
+#include <printf.h>
+#include <elfloader_common.h>
+#include <cpio/cpio.h>
+
+#include "cpio_index.h"
+
+static struct cpio_index_entry entries[CPIO_INDEX_MAX_ENTRIES];
+static unsigned int num_entries;
+
+int cpio_index_init(void const *cpio, size_t cpio_len)
+{
+    char const *pos = cpio;
+    char const *end = pos + cpio_len;
+
+    num_entries = 0;
+    while (pos < end) {
+        char const *name;
+        unsigned long size;
+        void const *data;
+        struct cpio_header const *next;
+        int ret = cpio_parse_header((struct cpio_header const *)pos,
+                                    (unsigned long)(end - pos), &name, &size,
+                                    &data, &next);
+        if (ret == 1) {
+            /* This is the trailer. */
+            break;
+        }
+        if (ret != 0) {
+            printf("ERROR: Invalid CPIO header at %p\n", pos);
+            return -1;
+        }
+        if (num_entries == ARRAY_SIZE(entries)) {
+            printf("ERROR: More than %u files in archive\n",
+                   (unsigned int)ARRAY_SIZE(entries));
+            return -1;
+        }
+
+        /* Ensure we can safely cast the CPIO API type to our preferred type. */
+        _Static_assert(sizeof(size) <= sizeof(size_t),
+                       "integer model mismatch");
+        entries[num_entries].name = name;
+        entries[num_entries].data = data;
+        entries[num_entries].size = (size_t)size;
+        num_entries++;
+
+        pos = (char const *)next;
+    }
+
+    return 0;
+}
+
+void const *cpio_index_get_entry(unsigned int n, char const **name,
+                                 size_t *size)
+{
+    if (n >= num_entries) {
+        return NULL;
+    }
+
+    if (name) {
+        *name = entries[n].name;
+    }
+    if (size) {
+        *size = entries[n].size;
+    }
+    return entries[n].data;
+}
+
+void const *cpio_index_get_file(char const *name, size_t *size)
+{
+    for (unsigned int i = 0; i < num_entries; i++) {
+        if (0 == strcmp(entries[i].name, name)) {
+            return cpio_index_get_entry(i, NULL, size);
+        }
+    }
+
+    return NULL;
+}
+
+void const *cpio_index_copy_aligned(void const *data, size_t size,
+                                    uint64_t *buffer, size_t buffer_size)
+{
+    if (size > buffer_size) {
+        return NULL;
+    }
+
+    memcpy(buffer, data, size);
+    return buffer;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <types.h>
+
+/*
+ * Index of the ELF-loader's CPIO archive. The archive headers are parsed once
+ * by cpio_index_init(), all lookups afterwards are served from the index and
+ * don't walk the archive again.
+ */
+
+/* Maximum number of members in the archive. */
+#define CPIO_INDEX_MAX_ENTRIES  128
+
+struct cpio_index_entry {
+    char const *name;
+    void const *data;
+    size_t size;
+};
+
+/* Build the index of the archive at 'cpio'. Returns 0 on success. */
+int cpio_index_init(void const *cpio, size_t cpio_len);
+
+/*
+ * Get member 'n' of the archive, returns NULL if there is none. 'name' and
+ * 'size' may be NULL.
+ */
+void const *cpio_index_get_entry(unsigned int n, char const **name,
+                                 size_t *size);
+
+/* Get the member called 'name', returns NULL if there is none. 'size' may be
+ * NULL.
+ */
+void const *cpio_index_get_file(char const *name, size_t *size);
+
+/*
+ * The archive aligns its members to 4 bytes only. Members with 64-bit values
+ * are copied to an aligned 'buffer' with this, so there are no unaligned
+ * accesses while the MMU is off. Returns the copy of the 'size' bytes at
+ * 'data', or NULL if they do not fit into the 'buffer_size' bytes of 'buffer'.
+ */
+void const *cpio_index_copy_aligned(void const *data, size_t size,
+                                    uint64_t *buffer, size_t buffer_size);
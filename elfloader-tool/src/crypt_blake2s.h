@@ -0,0 +1,27 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t h[8];   /* hash state */
+    uint32_t t[2];   /* processed message length */
+    uint32_t buflen; /* bytes in buf */
+    uint8_t buf[64]; /* message block buffer, the last block is kept */
+} blake2s_t;
+
+/* BLAKE2s-256 as in RFC 7693, without a key. */
+void blake2s_init(blake2s_t *s);
+void blake2s_sum(blake2s_t *s, uint8_t *md);
+void blake2s_update(blake2s_t *s, const void *m, unsigned long len);
+
+#ifdef __cplusplus
+}
+#endif
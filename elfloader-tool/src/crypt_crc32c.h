@@ -0,0 +1,34 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t crc;    /* CRC register, not inverted yet */
+} crc32c_t;
+
+/* CRC-32C (Castagnoli) as used by iSCSI and ext4. It detects corruption, but
+ * unlike the other hashes it is no protection against deliberate changes. The
+ * sum is stored big endian, i.e. in the order the value is usually printed.
+ */
+void crc32c_init(crc32c_t *s);
+void crc32c_sum(crc32c_t *s, uint8_t *md);
+void crc32c_update(crc32c_t *s, const void *m, unsigned long len);
+
+/* Update functions for the table of loader primitives, they take and return
+ * the CRC register.
+ */
+uint32_t crc32c_update_generic(uint32_t crc, const uint8_t *data, size_t len);
+/* with ElfloaderCrc32cArmV8 */
+uint32_t crc32c_update_arm(uint32_t crc, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -26,6 +26,15 @@ void sha256_init(sha256_t *s);
 void sha256_sum(sha256_t *s, uint8_t *md);
 void sha256_update(sha256_t *s, const void *m, unsigned long len);
 
+/* Block functions for the table of loader primitives. Each processes 'blocks'
+ * 64 byte blocks at 'data'.
+ */
+void sha256_blocks_generic(uint32_t h[8], const uint8_t *data, size_t blocks);
+/* arch-arm/armv/armv8-a/64/sha256_ce.S, with ElfloaderSha256ArmCE */
+void sha256_ce_blocks(uint32_t h[8], const uint8_t *data, size_t blocks);
+/* with ElfloaderSha256RiscVZknh */
+void sha256_blocks_zknh(uint32_t h[8], const uint8_t *data, size_t blocks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,11 +4,28 @@
  * SPDX-License-Identifier: GPL-2.0-only
  */
 #include <types.h>
+#include <strops.h>
+#include <elfloader_common.h>
+#include <fdt.h>
 
 #define FDT_MAGIC (0xd00dfeed)
 /* Newest FDT version that we understand */
 #define FDT_MAX_VER 17
 
+/* Tokens in the structure block */
+#define FDT_BEGIN_NODE  1
+#define FDT_END_NODE    2
+#define FDT_PROP        3
+#define FDT_NOP         4
+#define FDT_END         9
+
+/*
+ * Strings blocks up to this size are compacted when packing, larger ones are
+ * copied as they are. Typical device trees have a few KiB of strings.
+ */
+#define FDT_PACK_MAX_STRINGS    16384
+#define FDT_PACK_NO_STRING      0xffff
+
 struct fdt_header {
     uint32_t magic;
     uint32_t totalsize;
@@ -44,3 +61,512 @@ size_t fdt_size(
     return be32_to_le(hdr->totalsize);
 }
 
+static uint32_t get_be32(
+    char const *p)
+{
+    return be32_to_le(*(uint32_t const *)p);
+}
+
+static void put_be32(
+    char *p,
+    uint32_t val)
+{
+    *(uint32_t *)p = be32_to_le(val);
+}
+
+/*
+ * Get the token at 'pos' in the structure block and the size it takes up,
+ * including its padded payload. Returns 0 if the token is invalid or does not
+ * fit in the block.
+ */
+static uint32_t get_token(
+    char const *block,
+    uint32_t block_size,
+    uint32_t pos,
+    uint32_t *size)
+{
+    if ((pos > block_size) || (block_size - pos < 4)) {
+        return 0;
+    }
+
+    uint32_t token = get_be32(block + pos);
+    uint32_t len = 4;
+    if (token == FDT_BEGIN_NODE) {
+        /* The node name follows the token. */
+        while ((pos + len < block_size) && (block[pos + len] != '\0')) {
+            len++;
+        }
+        if (pos + len == block_size) {
+            return 0;
+        }
+        len = ROUND_UP(len + 1, 2);
+    } else if (token == FDT_PROP) {
+        /* The value length and name offset follow the token, then the value. */
+        if (block_size - pos < 12) {
+            return 0;
+        }
+        uint32_t value_len = get_be32(block + pos + 4);
+        if (value_len > block_size - pos - 12) {
+            return 0;
+        }
+        len = 12 + ROUND_UP(value_len, 2);
+    } else if ((token != FDT_END_NODE) && (token != FDT_NOP) &&
+               (token != FDT_END)) {
+        return 0;
+    }
+
+    if (len > block_size - pos) {
+        return 0;
+    }
+
+    *size = len;
+    return token;
+}
+
+/* Length of the string at 'nameoff' in the strings block, -1 if invalid. */
+static int get_string_len(
+    char const *strings,
+    uint32_t strings_size,
+    uint32_t nameoff)
+{
+    for (uint32_t pos = nameoff; pos < strings_size; pos++) {
+        if (strings[pos] == '\0') {
+            return (int)(pos - nameoff);
+        }
+    }
+    return -1;
+}
+
+/*
+ * Get the offsets and sizes of the structure and the strings block. Returns the
+ * size of the FDT, or 0 if it is invalid.
+ */
+static size_t get_blocks(
+    void const *fdt,
+    uint32_t *struct_off,
+    uint32_t *struct_size,
+    uint32_t *strings_off,
+    uint32_t *strings_size)
+{
+    struct fdt_header const *hdr = fdt;
+
+    size_t size = fdt_size(fdt);
+    if ((0 == size) || !IS_ALIGNED((uintptr_t)fdt, 2) ||
+        (be32_to_le(hdr->version) < FDT_MAX_VER)) {
+        return 0;
+    }
+
+    *struct_off = be32_to_le(hdr->off_dt_struct);
+    *struct_size = be32_to_le(hdr->size_dt_struct);
+    *strings_off = be32_to_le(hdr->off_dt_strings);
+    *strings_size = be32_to_le(hdr->size_dt_strings);
+    if ((size < sizeof(*hdr)) ||
+        !IS_ALIGNED(*struct_off, 2) || (*struct_off > size) ||
+        (*struct_size > size - *struct_off) ||
+        (*strings_off > size) || (*strings_size > size - *strings_off)) {
+        return 0;
+    }
+
+    return size;
+}
+
+/* New offset in the compacted strings block for each old one. */
+static uint16_t string_map[FDT_PACK_MAX_STRINGS];
+
+size_t fdt_pack(
+    void *dest,
+    size_t dest_size,
+    void const *fdt)
+{
+    struct fdt_header const *hdr = fdt;
+    char const *src = fdt;
+    uint32_t struct_off, struct_size, strings_off, strings_size;
+
+    size_t size = get_blocks(fdt, &struct_off, &struct_size, &strings_off,
+                             &strings_size);
+    uint32_t rsvmap_off = be32_to_le(hdr->off_mem_rsvmap);
+    if ((0 == size) || !IS_ALIGNED(rsvmap_off, 3) || (rsvmap_off > size)) {
+        return 0;
+    }
+
+    /* The memory reservation map ends with an empty entry. */
+    uint32_t rsvmap_size = 0;
+    for (;;) {
+        if (size - rsvmap_off - rsvmap_size < 16) {
+            return 0;
+        }
+        char const *entry = src + rsvmap_off + rsvmap_size;
+        rsvmap_size += 16;
+        if ((get_be32(entry) | get_be32(entry + 4) | get_be32(entry + 8) |
+             get_be32(entry + 12)) == 0) {
+            break;
+        }
+    }
+
+    /* Find the size of the structure block without NOPs and of the strings
+     * that are still used.
+     */
+    char const *block = src + struct_off;
+    char const *strings = src + strings_off;
+    int is_compact = (strings_size <= ARRAY_SIZE(string_map));
+    if (is_compact) {
+        memset(string_map, 0xff, strings_size * sizeof(string_map[0]));
+    }
+    uint32_t new_struct_size = 0;
+    uint32_t new_strings_size = 0;
+    uint32_t token = 0;
+    for (uint32_t pos = 0, len; token != FDT_END; pos += len) {
+        token = get_token(block, struct_size, pos, &len);
+        if (token == 0) {
+            return 0;
+        }
+        if (token == FDT_NOP) {
+            continue;
+        }
+        new_struct_size += len;
+        if (token != FDT_PROP) {
+            continue;
+        }
+        uint32_t nameoff = get_be32(block + pos + 8);
+        int name_len = get_string_len(strings, strings_size, nameoff);
+        if (name_len < 0) {
+            return 0;
+        }
+        if (is_compact && (string_map[nameoff] == FDT_PACK_NO_STRING)) {
+            string_map[nameoff] = new_strings_size;
+            new_strings_size += name_len + 1;
+            /* Strings that share a suffix can make it grow. */
+            if (new_strings_size > strings_size) {
+                is_compact = 0;
+            }
+        }
+    }
+    if (!is_compact) {
+        new_strings_size = strings_size;
+    }
+
+    uint32_t new_rsvmap_off = sizeof(*hdr);
+    uint32_t new_struct_off = new_rsvmap_off + rsvmap_size;
+    uint32_t new_strings_off = new_struct_off + new_struct_size;
+    uint32_t new_size = new_strings_off + new_strings_size;
+    if (new_size > dest_size) {
+        return 0;
+    }
+
+    char *out = dest;
+    struct fdt_header *new_hdr = dest;
+    new_hdr->magic = hdr->magic;
+    put_be32((char *)&new_hdr->totalsize, new_size);
+    put_be32((char *)&new_hdr->off_dt_struct, new_struct_off);
+    put_be32((char *)&new_hdr->off_dt_strings, new_strings_off);
+    put_be32((char *)&new_hdr->off_mem_rsvmap, new_rsvmap_off);
+    put_be32((char *)&new_hdr->version, FDT_MAX_VER);
+    new_hdr->last_comp_version = hdr->last_comp_version;
+    new_hdr->boot_cpuid_phys = hdr->boot_cpuid_phys;
+    put_be32((char *)&new_hdr->size_dt_strings, new_strings_size);
+    put_be32((char *)&new_hdr->size_dt_struct, new_struct_size);
+
+    memcpy(out + new_rsvmap_off, src + rsvmap_off, rsvmap_size);
+
+    char *new_block = out + new_struct_off;
+    token = 0;
+    for (uint32_t pos = 0, len; token != FDT_END; pos += len) {
+        token = get_token(block, struct_size, pos, &len);
+        if (token == FDT_NOP) {
+            continue;
+        }
+        memcpy(new_block, block + pos, len);
+        if (is_compact && (token == FDT_PROP)) {
+            put_be32(new_block + 8, string_map[get_be32(block + pos + 8)]);
+        }
+        new_block += len;
+    }
+
+    if (is_compact) {
+        for (uint32_t pos = 0; pos < strings_size; pos++) {
+            if (string_map[pos] != FDT_PACK_NO_STRING) {
+                memcpy(out + new_strings_off + string_map[pos], strings + pos,
+                       get_string_len(strings, strings_size, pos) + 1);
+            }
+        }
+    } else {
+        memcpy(out + new_strings_off, strings, strings_size);
+    }
+
+    return new_size;
+}
+
+/* Whether the node 'name' is called 'base', with or without a unit address. */
+static int is_node(
+    char const *name,
+    char const *base)
+{
+    size_t len = strlen(base);
+    return (0 == strncmp(name, base, len)) &&
+           ((name[len] == '\0') || (name[len] == '@'));
+}
+
+int fdt_for_each_cpu_prop(
+    void const *fdt,
+    fdt_cpu_prop_fn_t fn,
+    void *arg)
+{
+    char const *src = fdt;
+    uint32_t struct_off, struct_size, strings_off, strings_size;
+
+    if (0 == get_blocks(fdt, &struct_off, &struct_size, &strings_off,
+                        &strings_size)) {
+        return -1;
+    }
+
+    /* The root node is at depth 1, /cpus at 2 and the CPU nodes at 3. */
+    char const *block = src + struct_off;
+    char const *strings = src + strings_off;
+    int depth = 0;
+    int is_cpus = 0;
+    int is_cpu = 0;
+    int num_cpus = 0;
+    uint32_t token = 0;
+    for (uint32_t pos = 0, len; token != FDT_END; pos += len) {
+        token = get_token(block, struct_size, pos, &len);
+        if (token == 0) {
+            return -1;
+        }
+        if (token == FDT_BEGIN_NODE) {
+            char const *name = block + pos + 4;
+            depth++;
+            if ((depth == 2) && is_node(name, "cpus")) {
+                is_cpus = 1;
+            } else if ((depth == 3) && is_cpus && is_node(name, "cpu")) {
+                is_cpu = 1;
+                num_cpus++;
+            }
+        } else if (token == FDT_END_NODE) {
+            if (depth == 0) {
+                return -1;
+            }
+            if (depth == 2) {
+                is_cpus = 0;
+            } else if (depth == 3) {
+                is_cpu = 0;
+            }
+            depth--;
+        } else if ((token == FDT_PROP) && is_cpu && (depth == 3)) {
+            uint32_t nameoff = get_be32(block + pos + 8);
+            if (get_string_len(strings, strings_size, nameoff) < 0) {
+                return -1;
+            }
+            fn(arg, num_cpus - 1, strings + nameoff, block + pos + 12,
+               get_be32(block + pos + 4));
+        }
+    }
+
+    return num_cpus;
+}
+
+void const *fdt_get_prop(
+    void const *fdt,
+    char const *node,
+    char const *name,
+    uint32_t *len)
+{
+    char const *src = fdt;
+    uint32_t struct_off, struct_size, strings_off, strings_size;
+
+    if (0 == get_blocks(fdt, &struct_off, &struct_size, &strings_off,
+                        &strings_size)) {
+        return NULL;
+    }
+
+    char const *block = src + struct_off;
+    char const *strings = src + strings_off;
+    int depth = 0;
+    int is_match = 0;
+    uint32_t token = 0;
+    for (uint32_t pos = 0, tlen; token != FDT_END; pos += tlen) {
+        token = get_token(block, struct_size, pos, &tlen);
+        if (token == 0) {
+            return NULL;
+        }
+        if (token == FDT_BEGIN_NODE) {
+            depth++;
+            is_match = (depth == 2) && (0 == strcmp(block + pos + 4, node));
+        } else if (token == FDT_END_NODE) {
+            if (depth == 0) {
+                return NULL;
+            }
+            depth--;
+            is_match = 0;
+        } else if ((token == FDT_PROP) && is_match) {
+            uint32_t nameoff = get_be32(block + pos + 8);
+            if (get_string_len(strings, strings_size, nameoff) < 0) {
+                return NULL;
+            }
+            if (0 == strcmp(strings + nameoff, name)) {
+                *len = get_be32(block + pos + 4);
+                return block + pos + 12;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+size_t fdt_grow(
+    void *fdt,
+    size_t extra)
+{
+    struct fdt_header *hdr = fdt;
+
+    size_t size = fdt_size(fdt);
+    if ((0 == size) || (extra > UINT32_MAX - size)) {
+        return 0;
+    }
+
+    put_be32((char *)&hdr->totalsize, size + extra);
+    return size + extra;
+}
+
+/*
+ * The properties are added to the structure block, which the strings block
+ * follows in the usual layout.
+ */
+static int is_addable(
+    void const *fdt,
+    uint32_t struct_off,
+    uint32_t struct_size,
+    uint32_t strings_off)
+{
+    struct fdt_header const *hdr = fdt;
+
+    return (be32_to_le(hdr->off_mem_rsvmap) <= struct_off) &&
+           (strings_off >= struct_off + struct_size);
+}
+
+size_t fdt_free_space(
+    void const *fdt)
+{
+    uint32_t struct_off, struct_size, strings_off, strings_size;
+
+    size_t size = get_blocks(fdt, &struct_off, &struct_size, &strings_off,
+                             &strings_size);
+    if ((0 == size) || !is_addable(fdt, struct_off, struct_size, strings_off)) {
+        return 0;
+    }
+    return size - (strings_off + strings_size);
+}
+
+/* Offset of the string 'name' in the strings block, 'strings_size' if none. */
+static uint32_t find_string(
+    char const *strings,
+    uint32_t strings_size,
+    char const *name)
+{
+    int name_len = strlen(name);
+
+    /* A string may also be the end of a longer one. */
+    for (uint32_t pos = 0; pos < strings_size; pos++) {
+        if ((get_string_len(strings, strings_size, pos) == name_len) &&
+            (0 == strncmp(strings + pos, name, name_len))) {
+            return pos;
+        }
+    }
+    return strings_size;
+}
+
+void *fdt_add_chosen_prop(
+    void *fdt,
+    char const *name,
+    uint32_t len)
+{
+    struct fdt_header *hdr = fdt;
+    char *out = fdt;
+    uint32_t struct_off, struct_size, strings_off, strings_size;
+
+    /* Everything behind the new property is moved up. */
+    size_t size = get_blocks(fdt, &struct_off, &struct_size, &strings_off,
+                             &strings_size);
+    if ((0 == size) || !is_addable(fdt, struct_off, struct_size, strings_off)) {
+        return NULL;
+    }
+
+    /* The property goes first in /chosen. Without /chosen, the node is added
+     * last in the root node. A property with the same name is replaced by
+     * NOPs.
+     */
+    char *block = out + struct_off;
+    char const *strings = out + strings_off;
+    uint32_t chosen_pos = 0;
+    uint32_t root_end = 0;
+    int depth = 0;
+    int is_chosen = 0;
+    uint32_t token = 0;
+    for (uint32_t pos = 0, tlen; token != FDT_END; pos += tlen) {
+        token = get_token(block, struct_size, pos, &tlen);
+        if (token == 0) {
+            return NULL;
+        }
+        if (token == FDT_BEGIN_NODE) {
+            depth++;
+            if ((depth == 2) && (0 == strcmp(block + pos + 4, "chosen"))) {
+                is_chosen = 1;
+                chosen_pos = pos + tlen;
+            }
+        } else if (token == FDT_END_NODE) {
+            if (depth == 0) {
+                return NULL;
+            }
+            if (depth == 1) {
+                root_end = pos;
+            }
+            is_chosen = 0;
+            depth--;
+        } else if ((token == FDT_PROP) && is_chosen && (depth == 2)) {
+            uint32_t nameoff = get_be32(block + pos + 8);
+            if (get_string_len(strings, strings_size, nameoff) < 0) {
+                return NULL;
+            }
+            if (0 == strcmp(strings + nameoff, name)) {
+                for (uint32_t i = 0; i < tlen; i += 4) {
+                    put_be32(block + pos + i, FDT_NOP);
+                }
+            }
+        }
+    }
+    if (0 == root_end) {
+        return NULL;
+    }
+
+    uint32_t nameoff = find_string(strings, strings_size, name);
+    uint32_t name_size = (nameoff == strings_size) ? strlen(name) + 1 : 0;
+    uint32_t prop_size = 12 + ROUND_UP(len, 2);
+    uint32_t node_size = chosen_pos ? 0 : 4 + ROUND_UP(sizeof("chosen"), 2) + 4;
+    uint32_t grow = node_size + prop_size;
+    uint32_t pos = chosen_pos ? chosen_pos : root_end;
+    uint32_t used = strings_off + strings_size;
+    if ((len > size) || (size - used < grow + name_size)) {
+        return NULL;
+    }
+
+    memmove(block + pos + grow, block + pos, used - (struct_off + pos));
+    memcpy(out + strings_off + grow + strings_size, name, name_size);
+
+    char *prop = block + pos;
+    if (node_size) {
+        put_be32(prop, FDT_BEGIN_NODE);
+        memset(prop + 4, 0, ROUND_UP(sizeof("chosen"), 2));
+        memcpy(prop + 4, "chosen", sizeof("chosen"));
+        prop += 4 + ROUND_UP(sizeof("chosen"), 2);
+        put_be32(prop + prop_size, FDT_END_NODE);
+    }
+    put_be32(prop, FDT_PROP);
+    put_be32(prop + 4, len);
+    put_be32(prop + 8, nameoff);
+    memset(prop + 12, 0, ROUND_UP(len, 2));
+
+    put_be32((char *)&hdr->off_dt_strings, strings_off + grow);
+    put_be32((char *)&hdr->size_dt_strings, strings_size + name_size);
+    put_be32((char *)&hdr->size_dt_struct, struct_size + grow);
+
+    return prop + 12;
+}
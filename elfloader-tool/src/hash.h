@@ -12,25 +12,72 @@
 
 #pragma once
 
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
 #include "crypt_sha256.h"
 #include "crypt_md5.h"
+#include "crypt_blake2s.h"
+#include "crypt_crc32c.h"
 #include <types.h>
 
+/* Data that is copied and hashed is processed in chunks of this size. Each
+ * chunk is hashed right after it has been copied. With ElfloaderCachedLoad, it
+ * is small enough to still be in the data cache then, so it is fetched from
+ * memory just once. With the caches off, the hash reads it from memory again.
+ */
+#define HASH_CHUNK_SIZE     4096
+
 /* enum to store the hashing methods */
 enum hash_methods {
     SHA_256,
-    MD5
+    MD5,
+    BLAKE2S,
+    CRC32C
 };
 
+/* The hashing method the ELF-loader is configured for and its hash size. */
+#if defined(CONFIG_HASH_SHA)
+#define HASH_CONFIG_TYPE    SHA_256
+#define HASH_CONFIG_LEN     32
+#elif defined(CONFIG_HASH_BLAKE2S)
+#define HASH_CONFIG_TYPE    BLAKE2S
+#define HASH_CONFIG_LEN     32
+#elif defined(CONFIG_HASH_CRC32C)
+#define HASH_CONFIG_TYPE    CRC32C
+#define HASH_CONFIG_LEN     4
+#else
+#define HASH_CONFIG_TYPE    MD5
+#define HASH_CONFIG_LEN     16
+#endif
+
 /* Structure that contains a structure for each hash type and an integer
  * representation of the hashing method used
  */
 typedef struct {
     sha256_t sha_structure;
     md5_t md5_structure;
+    blake2s_t blake2s_structure;
+    crc32c_t crc32c_structure;
     unsigned int hash_type;
 } hashes_t;
 
+void hash_init(
+    hashes_t *hashes);
+
+/* Start a hash of the type the ELF-loader is configured for. */
+void hash_init_config(
+    hashes_t *hashes);
+
+void hash_update(
+    hashes_t *hashes,
+    const void *data,
+    size_t len);
+
+void hash_final(
+    hashes_t *hashes,
+    void *outputted_hash);
+
 void get_hash(
     hashes_t hashes,
     const void *data,
@@ -41,3 +88,9 @@ void print_hash(
     void const *hash,
     size_t len);
 
+/* Whether the hashes 'a' and 'b' of 'len' bytes are the same. */
+int hash_is_equal(
+    void const *a,
+    void const *b,
+    size_t len);
+
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+#include <printf.h>
+#include <elfloader_common.h>
+
+#include "hash.h"
+#include "hash_tree.h"
+#include "workers.h"
+
+/* hash_tree.py packs the header with the same layout, it has no 64-bit
+ * values, so it is used where it is in the archive.
+ */
+_Static_assert(sizeof(struct hash_tree) == 56, "hash tree header size");
+
+/* The leaves one core checks, in order. */
+struct leaf_range {
+    struct hash_tree const *tree;
+    void const *data;
+    hash_tree_copy_fn_t copy;
+    void *arg;
+    unsigned int first;
+    unsigned int end;
+};
+
+static struct leaf_range leaf_ranges[CONFIG_MAX_NUM_NODES];
+
+/* Set by the first core that finds a bad leaf, the others stop then. */
+static volatile int is_bad;
+static volatile unsigned int bad_leaf;
+
+static uint8_t const *get_leaf_hash(
+    struct hash_tree const *tree,
+    unsigned int leaf)
+{
+    return (uint8_t const *)(tree + 1) + (size_t)leaf * HASH_TREE_HASH_LEN;
+}
+
+struct hash_tree const *hash_tree_get(
+    void const *file,
+    size_t file_size,
+    size_t data_size)
+{
+    struct hash_tree const *tree = file;
+
+    if (file_size < sizeof(*tree)) {
+        printf("ERROR: hash tree size %u invalid\n", file_size);
+        return NULL;
+    }
+
+    if ((tree->magic != HASH_TREE_MAGIC) ||
+        (tree->version != HASH_TREE_VERSION) ||
+        (tree->leaf_bits < HASH_TREE_MIN_LEAF_BITS) ||
+        (tree->leaf_bits > HASH_TREE_MAX_LEAF_BITS)) {
+        printf("ERROR: hash tree invalid\n");
+        return NULL;
+    }
+
+    uint64_t num_leaves = ((uint64_t)data_size + BIT(tree->leaf_bits) - 1)
+                          >> tree->leaf_bits;
+    size_t leaves_size = file_size - sizeof(*tree);
+    if ((tree->data_size != data_size) ||
+        (tree->num_leaves != num_leaves) ||
+        (leaves_size / HASH_TREE_HASH_LEN != num_leaves) ||
+        (leaves_size % HASH_TREE_HASH_LEN != 0)) {
+        printf("ERROR: hash tree is for %u bytes in %u leaves, data has %u\n",
+               tree->data_size, tree->num_leaves, data_size);
+        return NULL;
+    }
+
+    /* The root guards the leaf hashes, which are used where they are. */
+    hashes_t hashes;
+    uint8_t root[HASH_TREE_HASH_LEN];
+    hash_init_config(&hashes);
+    hash_update(&hashes, tree, __builtin_offsetof(struct hash_tree, root));
+    hash_update(&hashes, get_leaf_hash(tree, 0),
+                (size_t)tree->num_leaves * HASH_TREE_HASH_LEN);
+    hash_final(&hashes, root);
+    if (!hash_is_equal(root, tree->root, HASH_CONFIG_LEN)) {
+        printf("ERROR: hash tree root does not match its leaves\n");
+        return NULL;
+    }
+
+    printf("Hash tree root: ");
+    print_hash(tree->root, HASH_CONFIG_LEN);
+
+    return tree;
+}
+
+static void verify_leaves(void *arg)
+{
+    struct leaf_range const *range = arg;
+    struct hash_tree const *tree = range->tree;
+    size_t leaf_size = BIT(tree->leaf_bits);
+
+    for (unsigned int leaf = range->first; leaf < range->end; leaf++) {
+        if (is_bad) {
+            return;
+        }
+
+        size_t offset = (size_t)leaf << tree->leaf_bits;
+        size_t end = offset + MIN(tree->data_size - offset, leaf_size);
+        uint8_t hash[HASH_TREE_HASH_LEN];
+        hashes_t hashes;
+        hash_init_config(&hashes);
+        /* The chunk is copied while it is still in the data cache. */
+        for (size_t pos = offset; pos < end; pos += HASH_CHUNK_SIZE) {
+            size_t len = MIN(end - pos, HASH_CHUNK_SIZE);
+            void const *src = (uint8_t const *)range->data + pos;
+            hash_update(&hashes, src, len);
+            if (range->copy) {
+                range->copy(range->arg, pos, len, src);
+            }
+        }
+        hash_final(&hashes, hash);
+        if (!hash_is_equal(hash, get_leaf_hash(tree, leaf),
+                           HASH_CONFIG_LEN)) {
+            bad_leaf = leaf;
+            is_bad = 1;
+            return;
+        }
+    }
+}
+
+int hash_tree_verify(
+    struct hash_tree const *tree,
+    void const *data,
+    hash_tree_copy_fn_t copy,
+    void *arg)
+{
+    /* Each worker gets a contiguous range of leaves, the boot core the first
+     * one, so a bad leaf early in the data is found first.
+     */
+    unsigned int num_ranges = MIN(workers_online() + 1, CONFIG_MAX_NUM_NODES);
+    unsigned int per_range = (tree->num_leaves + num_ranges - 1) / num_ranges;
+
+    is_bad = 0;
+    for (unsigned int i = 0; i < num_ranges; i++) {
+        struct leaf_range *range = &leaf_ranges[i];
+        range->tree = tree;
+        range->data = data;
+        range->copy = copy;
+        range->arg = arg;
+        range->first = MIN(i * per_range, tree->num_leaves);
+        range->end = MIN(range->first + per_range, tree->num_leaves);
+        if (i > 0) {
+            workers_call(verify_leaves, range);
+        }
+    }
+    verify_leaves(&leaf_ranges[0]);
+    workers_wait();
+
+    if (is_bad) {
+        printf("ERROR: hash tree leaf %u at offset %u does not match\n",
+               bad_leaf, bad_leaf << tree->leaf_bits);
+        return -1;
+    }
+
+    printf("  %u leaves of %u KiB match\n", tree->num_leaves,
+           BIT(tree->leaf_bits) / 1024);
+    return 0;
+}
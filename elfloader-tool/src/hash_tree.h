@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+
+#ifdef CONFIG_ELFLOADER_HASH_TREE
+
+/*
+ * With a hash tree, the hash file of an image is generated at build time by
+ * cmake-tool/helpers/hash_tree.py. Instead of a single hash of the whole file,
+ * it has a hash of each leaf, a fixed size chunk of the file, and a root hash
+ * over the header and all leaf hashes. The leaves are checked independently,
+ * so the work is spread over the workers, each copies the leaves it checks in
+ * the same pass and stops at the first bad leaf.
+ *
+ * All values are little endian and 32 bits wide, so the file can be used where
+ * it is in the archive. The layout here must be kept in sync with the
+ * generator script.
+ */
+
+#define HASH_TREE_MAGIC         0x45525448 /* "HTRE" */
+#define HASH_TREE_VERSION       1
+
+#define HASH_TREE_MIN_LEAF_BITS 12
+#define HASH_TREE_MAX_LEAF_BITS 24
+
+#define HASH_TREE_HASH_LEN      32
+
+struct hash_tree {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t leaf_bits;
+    uint32_t num_leaves;
+    uint32_t data_size;
+    uint32_t reserved;
+    /* hash of the fields above and all leaf hashes */
+    uint8_t root[HASH_TREE_HASH_LEN];
+    /* followed by num_leaves leaf hashes of HASH_TREE_HASH_LEN bytes */
+};
+
+/*
+ * Check the hash file 'file' of 'file_size' bytes, which must describe data of
+ * 'data_size' bytes. Returns NULL if it is invalid.
+ */
+struct hash_tree const *hash_tree_get(
+    void const *file,
+    size_t file_size,
+    size_t data_size);
+
+/*
+ * Called for each chunk of a leaf right after it has been hashed, with the
+ * offset of the chunk in the data. This runs on the workers.
+ */
+typedef void (*hash_tree_copy_fn_t)(
+    void *arg,
+    size_t offset,
+    size_t len,
+    void const *src);
+
+/*
+ * Check all leaves of 'data', passing them to 'copy' unless it is NULL.
+ * Returns 0 if they all match, -1 as soon as a bad leaf is found.
+ */
+int hash_tree_verify(
+    struct hash_tree const *tree,
+    void const *data,
+    hash_tree_copy_fn_t copy,
+    void *arg);
+
+#endif /* CONFIG_ELFLOADER_HASH_TREE */
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <printf.h>
+#include <types.h>
+#include <strops.h>
+
+#include "cpio_index.h"
+#include "load_plan.h"
+#include "workers.h"
+
+/* load_plan.py packs these structures with the same layout. */
+_Static_assert(sizeof(struct load_plan_header) == 24, "plan header size");
+_Static_assert(sizeof(struct load_plan_image) == 176, "plan image size");
+_Static_assert(sizeof(struct load_plan_op) == 32, "plan op size");
+
+#if defined(CONFIG_HASH_SHA)
+#define LOAD_PLAN_HASH_CONFIG   LOAD_PLAN_HASH_SHA256
+#elif defined(CONFIG_HASH_MD5)
+#define LOAD_PLAN_HASH_CONFIG   LOAD_PLAN_HASH_MD5
+#elif defined(CONFIG_HASH_BLAKE2S)
+#define LOAD_PLAN_HASH_CONFIG   LOAD_PLAN_HASH_BLAKE2S
+#else
+#define LOAD_PLAN_HASH_CONFIG   LOAD_PLAN_HASH_NONE
+#endif
+
+/* The plan contains 64-bit values, see cpio_index_copy_aligned(). */
+static uint64_t plan_buffer[LOAD_PLAN_MAX_SIZE / sizeof(uint64_t)];
+
+static struct load_plan_image const *plan_images(
+    struct load_plan_header const *plan)
+{
+    return (struct load_plan_image const *)(plan + 1);
+}
+
+static struct load_plan_op const *plan_ops(
+    struct load_plan_header const *plan)
+{
+    return (struct load_plan_op const *)(plan_images(plan) + plan->num_images);
+}
+
+/* Check that [offset..offset+size) lies within [0..limit). */
+static int range_is_within(
+    uint64_t offset,
+    uint64_t size,
+    uint64_t limit)
+{
+    return (offset <= limit) && (size <= limit - offset);
+}
+
+static int check_image(
+    struct load_plan_header const *plan,
+    struct load_plan_image const *image)
+{
+    if (image->name[LOAD_PLAN_NAME_LEN - 1] != '\0') {
+        printf("ERROR: load plan image name not terminated\n");
+        return -1;
+    }
+
+    if ((image->type < LOAD_PLAN_IMAGE_KERNEL) ||
+        (image->type > LOAD_PLAN_IMAGE_USER)) {
+        printf("ERROR: load plan image '%s' has invalid type %u\n",
+               image->name, image->type);
+        return -1;
+    }
+
+    if ((image->virt_end < image->virt_start) ||
+        (image->virt_end - image->virt_start > UINTPTR_MAX) ||
+        !IS_ALIGNED(image->virt_end, PAGE_BITS) ||
+        (image->phys_end < image->phys_start) ||
+        (image->phys_end > UINTPTR_MAX) ||
+        (image->file_size > UINTPTR_MAX)) {
+        printf("ERROR: load plan image '%s' has invalid bounds\n", image->name);
+        return -1;
+    }
+
+    if ((image->type == LOAD_PLAN_IMAGE_USER) &&
+        !range_is_within(image->phdr_offset,
+                         (uint64_t)image->phnum * image->phentsize,
+                         image->file_size)) {
+        printf("ERROR: load plan image '%s' has invalid program headers\n",
+               image->name);
+        return -1;
+    }
+
+    if (!range_is_within(image->first_op, image->num_ops, plan->num_ops)) {
+        printf("ERROR: load plan image '%s' has invalid operations\n",
+               image->name);
+        return -1;
+    }
+
+    uint64_t image_size = image->virt_end - image->virt_start;
+    struct load_plan_op const *op = &plan_ops(plan)[image->first_op];
+    for (unsigned int i = 0; i < image->num_ops; i++, op++) {
+        int ok;
+        switch (op->type) {
+        case LOAD_PLAN_OP_COPY_HASH:
+        case LOAD_PLAN_OP_COPY:
+            ok = range_is_within(op->src_offset, op->size, image->file_size) &&
+                 range_is_within(op->dest_offset, op->size, image_size);
+            break;
+        case LOAD_PLAN_OP_HASH:
+            ok = range_is_within(op->src_offset, op->size, image->file_size);
+            break;
+        case LOAD_PLAN_OP_ZERO:
+            ok = range_is_within(op->dest_offset, op->size, image_size);
+            break;
+        default:
+            ok = 0;
+            break;
+        }
+        if (!ok) {
+            printf("ERROR: load plan image '%s' operation %u invalid\n",
+                   image->name, i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+struct load_plan_header const *load_plan_get(
+    int *is_invalid)
+{
+    *is_invalid = 0;
+
+    size_t cpio_file_size = 0;
+    void const *blob = cpio_index_get_file(LOAD_PLAN_FILENAME, &cpio_file_size);
+    if (blob == NULL) {
+        return NULL;
+    }
+
+    *is_invalid = 1;
+
+    struct load_plan_header const *plan =
+        cpio_index_copy_aligned(blob, cpio_file_size, plan_buffer,
+                                sizeof(plan_buffer));
+    if (!plan || (cpio_file_size < sizeof(*plan))) {
+        printf("ERROR: load plan size %zu invalid\n", cpio_file_size);
+        return NULL;
+    }
+
+    if ((plan->magic != LOAD_PLAN_MAGIC) ||
+        (plan->version != LOAD_PLAN_VERSION)) {
+        printf("ERROR: load plan has unsupported format\n");
+        return NULL;
+    }
+
+    if (plan->hash_type != LOAD_PLAN_HASH_CONFIG) {
+        printf("ERROR: load plan hash type %u does not match configuration\n",
+               plan->hash_type);
+        return NULL;
+    }
+
+    /* The counts are 32-bit, so this can't overflow with 64-bit math. */
+    uint64_t plan_size = sizeof(struct load_plan_header)
+                         + (uint64_t)plan->num_images * sizeof(struct load_plan_image)
+                         + (uint64_t)plan->num_ops * sizeof(struct load_plan_op);
+    if (plan_size > cpio_file_size) {
+        printf("ERROR: load plan truncated\n");
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < plan->num_images; i++) {
+        if (0 != check_image(plan, &plan_images(plan)[i])) {
+            return NULL;
+        }
+    }
+
+    *is_invalid = 0;
+    return plan;
+}
+
+struct load_plan_image const *load_plan_get_image(
+    struct load_plan_header const *plan,
+    char const *name)
+{
+    for (unsigned int i = 0; i < plan->num_images; i++) {
+        struct load_plan_image const *image = &plan_images(plan)[i];
+        if (0 == strcmp(image->name, name)) {
+            return image;
+        }
+    }
+
+    return NULL;
+}
+
+void load_plan_run_image(
+    struct load_plan_header const *plan,
+    struct load_plan_image const *image,
+    void const *blob,
+    paddr_t dest_paddr,
+    hashes_t *hashes)
+{
+    struct load_plan_op const *op = &plan_ops(plan)[image->first_op];
+    struct load_plan_op const *end = op + image->num_ops;
+
+    for (; op < end; op++) {
+        char *dest = (char *)(dest_paddr + (size_t)op->dest_offset);
+        char const *src = (char const *)blob + (size_t)op->src_offset;
+        size_t size = (size_t)op->size;
+
+        switch (op->type) {
+        case LOAD_PLAN_OP_COPY_HASH:
+            if (hashes && (workers_online() > 0)) {
+                /* The workers copy while the boot core hashes. */
+                workers_memcpy(dest, src, size);
+                hash_update(hashes, src, size);
+                break;
+            }
+            if (hashes) {
+                while (size > 0) {
+                    size_t len = MIN(size, HASH_CHUNK_SIZE);
+                    memcpy(dest, src, len);
+                    hash_update(hashes, src, len);
+                    dest += len;
+                    src += len;
+                    size -= len;
+                }
+                break;
+            }
+        /* fall through */
+        case LOAD_PLAN_OP_COPY:
+            workers_memcpy(dest, src, size);
+            break;
+        case LOAD_PLAN_OP_HASH:
+            if (hashes) {
+                hash_update(hashes, src, size);
+            }
+            break;
+        case LOAD_PLAN_OP_ZERO:
+#ifndef CONFIG_ELFLOADER_PREZEROED_RAM
+            workers_memset(dest, 0, size);
+#endif
+            break;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <types.h>
+#include <elfloader_common.h>
+
+#include "hash.h"
+
+/*
+ * A load plan is generated at build time by cmake-tool/helpers/load_plan.py
+ * and stored in the CPIO archive as LOAD_PLAN_FILENAME. It describes for each
+ * image in the archive where it goes and which ranges must be copied, hashed
+ * and zeroed, so the ELF files don't have to be parsed at boot time. All
+ * values are little endian. The layout here must be kept in sync with the
+ * generator script.
+ */
+
+#define LOAD_PLAN_FILENAME      "load_plan.bin"
+
+#define LOAD_PLAN_MAGIC         0x4c504c45 /* "ELPL" */
+#define LOAD_PLAN_VERSION       1
+
+/* The plan is copied to an aligned buffer of this size before it is used. */
+#define LOAD_PLAN_MAX_SIZE      BIT(14)
+
+#define LOAD_PLAN_NAME_LEN      64
+#define LOAD_PLAN_HASH_LEN      32
+
+/* values for load_plan_header.hash_type */
+#define LOAD_PLAN_HASH_NONE     0
+#define LOAD_PLAN_HASH_SHA256   1
+#define LOAD_PLAN_HASH_MD5      2
+#define LOAD_PLAN_HASH_BLAKE2S  3
+
+/* values for load_plan_image.type */
+#define LOAD_PLAN_IMAGE_KERNEL  1
+#define LOAD_PLAN_IMAGE_DTB     2
+#define LOAD_PLAN_IMAGE_USER    3
+
+/* values for load_plan_op.type */
+#define LOAD_PLAN_OP_COPY_HASH  1 /* copy source range and feed it to hash */
+#define LOAD_PLAN_OP_COPY       2 /* copy source range */
+#define LOAD_PLAN_OP_HASH       3 /* feed source range to hash */
+#define LOAD_PLAN_OP_ZERO       4 /* zero destination range */
+
+struct load_plan_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hash_type;
+    uint32_t num_images;
+    uint32_t num_ops;
+    uint32_t reserved;
+    /* followed by num_images load_plan_image and num_ops load_plan_op */
+};
+
+struct load_plan_image {
+    char name[LOAD_PLAN_NAME_LEN]; /* archive member name, NUL terminated */
+    uint32_t type;
+    uint32_t first_op;
+    uint32_t num_ops;
+    uint32_t reserved;
+    uint64_t file_size;     /* size of the archive member */
+    uint64_t phys_start;    /* kernel only, physical load address */
+    uint64_t phys_end;      /* kernel only, end of the physical bounds */
+    uint64_t virt_start;
+    uint64_t virt_end;      /* rounded up to a page boundary */
+    uint64_t virt_entry;
+    uint64_t phdr_offset;   /* program header table, kept for user images */
+    uint32_t phnum;
+    uint32_t phentsize;
+    uint8_t hash[LOAD_PLAN_HASH_LEN]; /* hash of the archive member */
+};
+
+/*
+ * Operations of an image are sorted so that the hash operations cover the
+ * archive member in file order. Source offsets are relative to the start of
+ * the archive member, destination offsets relative to the physical start of
+ * the image.
+ */
+struct load_plan_op {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t dest_offset;
+    uint64_t src_offset;
+    uint64_t size;
+};
+
+/*
+ * Find the load plan in the archive and check it is consistent. Returns NULL
+ * if there is no plan or it is invalid, in the latter case 'is_invalid' is set.
+ */
+struct load_plan_header const *load_plan_get(
+    int *is_invalid);
+
+/* Find the plan entry for an archive member, returns NULL if there is none. */
+struct load_plan_image const *load_plan_get_image(
+    struct load_plan_header const *plan,
+    char const *name);
+
+/*
+ * Run all operations of an image, where 'blob' is the archive member and
+ * 'hashes' is either NULL or an initialized hash context.
+ */
+void load_plan_run_image(
+    struct load_plan_header const *plan,
+    struct load_plan_image const *image,
+    void const *blob,
+    paddr_t dest_paddr,
+    hashes_t *hashes);
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <types.h>
+
+/*
+ * Decompress a raw LZ4 block (no frame header) of 'src_len' bytes to 'dest'.
+ * The block must decompress to exactly 'dest_len' bytes, matches may only
+ * refer to data of the same block. Returns 0 on success, -1 if the block is
+ * malformed.
+ */
+int lz4_decompress_block(
+    void *dest,
+    size_t dest_len,
+    void const *src,
+    size_t src_len);
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <types.h>
+#include <printf.h>
+#include <elfloader_common.h>
+
+#include "placement.h"
+
+void placement_init(struct placement *p)
+{
+    p->num_ranges = 0;
+}
+
+int placement_add(struct placement *p, uint64_t start, uint64_t end)
+{
+    if (start >= end) {
+        return 0;
+    }
+
+    if (p->num_ranges == ARRAY_SIZE(p->ranges)) {
+        printf("ERROR: more than %u free memory ranges\n",
+               (unsigned int)ARRAY_SIZE(p->ranges));
+        return -1;
+    }
+
+    p->ranges[p->num_ranges].start = start;
+    p->ranges[p->num_ranges].end = end;
+    p->num_ranges++;
+    return 0;
+}
+
+int placement_reserve(struct placement *p, uint64_t start, uint64_t end)
+{
+    /* Ranges that get added by splitting are behind 'num', they don't overlap
+     * with the reserved range anyway.
+     */
+    unsigned int num = p->num_ranges;
+
+    for (unsigned int i = 0; i < num; i++) {
+        struct placement_range *r = &p->ranges[i];
+        if ((end <= r->start) || (start >= r->end)) {
+            continue;
+        }
+
+        uint64_t tail_start = end;
+        uint64_t tail_end = r->end;
+        if (start > r->start) {
+            r->end = start;
+        } else {
+            /* Keep the empty range, it is dropped below. */
+            r->end = r->start;
+        }
+        if (tail_start < tail_end) {
+            if (r->start == r->end) {
+                r->start = tail_start;
+                r->end = tail_end;
+            } else if (0 != placement_add(p, tail_start, tail_end)) {
+                return -1;
+            }
+        }
+    }
+
+    /* Drop all ranges that became empty. */
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < p->num_ranges; i++) {
+        if (p->ranges[i].start < p->ranges[i].end) {
+            p->ranges[n++] = p->ranges[i];
+        }
+    }
+    p->num_ranges = n;
+
+    return 0;
+}
+
+int placement_alloc(struct placement *p, uint64_t size, unsigned int align_bits,
+                    uint64_t *addr)
+{
+    struct placement_range const *best = NULL;
+    uint64_t best_addr = 0;
+
+    for (unsigned int i = 0; i < p->num_ranges; i++) {
+        struct placement_range const *r = &p->ranges[i];
+        if (r->end - r->start < size) {
+            continue;
+        }
+        /* Place it at the end of the range. */
+        uint64_t a = ROUND_DOWN(r->end - size, align_bits);
+        if (a < r->start) {
+            continue;
+        }
+        if (!best || (r->end - r->start < best->end - best->start)) {
+            best = r;
+            best_addr = a;
+        }
+    }
+
+    if (!best) {
+        return -1;
+    }
+
+    *addr = best_addr;
+    return placement_reserve(p, best_addr, best_addr + size);
+}
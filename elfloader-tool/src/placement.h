@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <types.h>
+
+/*
+ * Placement of images in the free parts of physical memory. Free memory is
+ * added range by range, everything that is in use already is reserved again.
+ * Allocations are best-fit, the smallest free range an image fits in is used
+ * and the image goes to the end of it. All values are 64-bit, so memory above
+ * 4 GiB works on any architecture.
+ */
+
+/* Maximum number of distinct free ranges. */
+#define PLACEMENT_MAX_RANGES    32
+
+struct placement_range {
+    uint64_t start;
+    uint64_t end;
+};
+
+struct placement {
+    unsigned int num_ranges;
+    struct placement_range ranges[PLACEMENT_MAX_RANGES];
+};
+
+void placement_init(struct placement *p);
+
+/*
+ * Add [start..end) as free memory, it must not overlap with any free range.
+ * Returns 0 on success.
+ */
+int placement_add(struct placement *p, uint64_t start, uint64_t end);
+
+/* Remove [start..end) from the free memory. Returns 0 on success. */
+int placement_reserve(struct placement *p, uint64_t start, uint64_t end);
+
+/*
+ * Allocate 'size' bytes at an address aligned to 'align_bits', the range is
+ * reserved. Returns 0 on success.
+ */
+int placement_alloc(struct placement *p, uint64_t size, unsigned int align_bits,
+                    uint64_t *addr);
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <printf.h>
+#include <primitives.h>
+
+#include "crypt_sha256.h"
+#include "crypt_crc32c.h"
+
+struct primitives primitives = {
+    .memcpy = default_memcpy,
+    .memzero = default_memzero,
+    .sha256_blocks = sha256_blocks_generic,
+    .crc32c_update = crc32c_update_generic,
+    /* Too small a line size makes cleaning slower, but it is still correct. */
+    .dcache_line_size = 16,
+    .memcpy_name = "default",
+    .memzero_name = "default",
+    .sha256_name = "default",
+    .crc32c_name = "default",
+};
+
+void primitives_init(void const *dtb)
+{
+    arch_init_primitives(&primitives, dtb);
+
+    printf("  memcpy: %s, memzero: %s\n", primitives.memcpy_name,
+           primitives.memzero_name);
+#if defined(CONFIG_HASH_SHA)
+    printf("  sha256: %s\n", primitives.sha256_name);
+#elif defined(CONFIG_HASH_CRC32C)
+    printf("  crc32c: %s\n", primitives.crc32c_name);
+#endif
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+#include <printf.h>
+#include <elfloader_common.h>
+#include <binaries/elf/elf.h>
+
+#include "cpio_index.h"
+#include "hash.h"
+#include "segment_digests.h"
+
+/* segment_digests.py packs these structures with the same layout. */
+_Static_assert(sizeof(struct segment_digests) == 48, "digests header size");
+_Static_assert(sizeof(struct segment_digest) == 48, "segment digest size");
+
+/* A program header as it is fed into the layout digest. */
+struct layout_phdr {
+    uint32_t type;
+    uint32_t flags;
+    uint64_t vaddr;
+    uint64_t paddr;
+    uint64_t file_size;
+    uint64_t mem_size;
+    uint64_t align;
+};
+
+_Static_assert(sizeof(struct layout_phdr) == 48, "layout phdr size");
+
+/* The digests contain 64-bit values, see cpio_index_copy_aligned(). */
+static uint64_t digests_buffer[(sizeof(struct segment_digests) +
+                                SEGMENT_DIGESTS_MAX_SEGMENTS *
+                                sizeof(struct segment_digest)) /
+                               sizeof(uint64_t)];
+
+static int is_zero(void const *data, size_t len)
+{
+    uint8_t const *pos = data;
+    uint8_t const *end = pos + len;
+
+    for (; (pos < end) && !IS_ALIGNED((uintptr_t)pos, 3); pos++) {
+        if (*pos) {
+            return 0;
+        }
+    }
+    for (; end - pos >= 8; pos += 8) {
+        if (*(uint64_t const *)pos) {
+            return 0;
+        }
+    }
+    for (; pos < end; pos++) {
+        if (*pos) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static struct segment_digest const *get_segment_digests(
+    struct segment_digests const *digests)
+{
+    return (struct segment_digest const *)(digests + 1);
+}
+
+static void get_layout_digest(
+    struct elf_view const *elf,
+    uint8_t digest[SEGMENT_DIGESTS_HASH_LEN])
+{
+    hashes_t hashes;
+
+    hash_init_config(&hashes);
+    for (unsigned int i = 0; i < elf->phnum; i++) {
+        struct elf_segment seg;
+        elf_view_get_segment(elf, i, &seg);
+        struct layout_phdr phdr = {
+            .type = seg.type,
+            .flags = seg.flags,
+            .vaddr = seg.vaddr,
+            .paddr = seg.paddr,
+            .file_size = seg.file_size,
+            .mem_size = seg.mem_size,
+            .align = seg.align,
+        };
+        hash_update(&hashes, &phdr, sizeof(phdr));
+    }
+    uint64_t entry = elf->entry;
+    hash_update(&hashes, &entry, sizeof(entry));
+
+    memset(digest, 0, SEGMENT_DIGESTS_HASH_LEN);
+    hash_final(&hashes, digest);
+}
+
+struct segment_digests const *segment_digests_load(
+    void const *file,
+    size_t file_size,
+    struct elf_view const *elf)
+{
+    struct segment_digests const *digests =
+        cpio_index_copy_aligned(file, file_size, digests_buffer,
+                                sizeof(digests_buffer));
+    if (!digests || (file_size < sizeof(*digests))) {
+        printf("ERROR: segment digests size %u invalid\n", file_size);
+        return NULL;
+    }
+
+    if ((digests->magic != SEGMENT_DIGESTS_MAGIC) ||
+        (digests->version != SEGMENT_DIGESTS_VERSION) ||
+        (digests->num_segments > SEGMENT_DIGESTS_MAX_SEGMENTS) ||
+        (file_size != sizeof(*digests) + digests->num_segments *
+         sizeof(struct segment_digest))) {
+        printf("ERROR: segment digests invalid\n");
+        return NULL;
+    }
+
+    uint8_t layout_digest[SEGMENT_DIGESTS_HASH_LEN];
+    get_layout_digest(elf, layout_digest);
+    if (!hash_is_equal(layout_digest, digests->layout_digest,
+                       HASH_CONFIG_LEN)) {
+        printf("ERROR: program headers do not match their digest\n");
+        return NULL;
+    }
+
+    /* The layout digest matched, so this only catches a broken generator. */
+    struct segment_digest const *segment = get_segment_digests(digests);
+    struct elf_segment seg;
+    unsigned int n = 0;
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        if ((n == digests->num_segments) ||
+            (segment[n].file_size != seg.file_size) ||
+            (segment[n].zero_size != seg.mem_size - seg.file_size) ||
+            (seg.mem_size < seg.file_size)) {
+            printf("ERROR: segment %u does not match segment digests\n", i);
+            return NULL;
+        }
+        n++;
+    }
+    if (n != digests->num_segments) {
+        printf("ERROR: segment digests for %u segments, but ELF has %u\n",
+               digests->num_segments, n);
+        return NULL;
+    }
+
+    return digests;
+}
+
+int segment_digests_verify(
+    struct segment_digests const *digests,
+    struct elf_view const *elf,
+    paddr_t dest_paddr)
+{
+    struct segment_digest const *segment = get_segment_digests(digests);
+    struct elf_segment seg;
+    unsigned int n = 0;
+
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        uint8_t const *data = (void const *)(dest_paddr +
+                                             (vaddr_t)(seg.vaddr
+                                                       - elf->min_vaddr));
+        size_t file_size = (size_t)segment[n].file_size;
+        size_t zero_size = (size_t)segment[n].zero_size;
+
+        hashes_t hashes;
+        uint8_t digest[SEGMENT_DIGESTS_HASH_LEN];
+        hash_init_config(&hashes);
+        hash_update(&hashes, data, file_size);
+        hash_final(&hashes, digest);
+        if (!hash_is_equal(digest, segment[n].digest, HASH_CONFIG_LEN)) {
+            printf("ERROR: segment %u at %p does not match its digest\n",
+                   i, data);
+            return -1;
+        }
+
+        if (!is_zero(data + file_size, zero_size)) {
+            printf("ERROR: zero fill of segment %u at %p is not zero\n",
+                   i, data + file_size);
+            return -1;
+        }
+
+        n++;
+    }
+
+    printf("  %u segments match their digests\n", n);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <elfloader_common.h>
+#include <binaries/elf/elf.h>
+
+#ifdef CONFIG_ELFLOADER_SEGMENT_DIGESTS
+
+/*
+ * With segment digests, the hash file of an image is generated at build time
+ * by cmake-tool/helpers/segment_digests.py. Instead of the hash of the whole
+ * ELF file, it has a digest of each loadable segment's file data, which is
+ * checked at the destination after the segment has been copied, and the size
+ * of the segment's zero fill, which is checked to be zero. So the work scales
+ * with the loaded data, sections that are not loaded (like debug information)
+ * are never read, and faults while copying are caught.
+ *
+ * The program headers and the entry point are covered by the layout digest.
+ * It is taken over all fields of all program headers except p_offset, which
+ * differs for a pre-positioned kernel, so where the file data comes from is
+ * covered by the segment digests only.
+ *
+ * All values are little endian. The layout here must be kept in sync with the
+ * generator script.
+ */
+
+#define SEGMENT_DIGESTS_MAGIC       0x44474553 /* "SEGD" */
+#define SEGMENT_DIGESTS_VERSION     1
+
+#define SEGMENT_DIGESTS_MAX_SEGMENTS 32
+
+#define SEGMENT_DIGESTS_HASH_LEN    32
+
+struct segment_digests {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_segments; /* number of PT_LOAD segments */
+    uint32_t reserved;
+    uint8_t layout_digest[SEGMENT_DIGESTS_HASH_LEN];
+    /* followed by num_segments segment_digest in program header order */
+};
+
+struct segment_digest {
+    uint64_t file_size;
+    uint64_t zero_size;
+    uint8_t digest[SEGMENT_DIGESTS_HASH_LEN]; /* of the file data */
+};
+
+/*
+ * Check the hash file 'file' of 'file_size' bytes against the program headers
+ * of the ELF file 'elf'. Returns the digests on success, they are valid until
+ * the next call. Returns NULL if the hash file is invalid or does not match.
+ */
+struct segment_digests const *segment_digests_load(
+    void const *file,
+    size_t file_size,
+    struct elf_view const *elf);
+
+/*
+ * Check all loadable segments of 'elf' that have been loaded to 'dest_paddr'.
+ * All copies must have completed. Returns 0 if they match the digests.
+ */
+int segment_digests_verify(
+    struct segment_digests const *digests,
+    struct elf_view const *elf,
+    paddr_t dest_paddr);
+
+#endif /* CONFIG_ELFLOADER_SEGMENT_DIGESTS */
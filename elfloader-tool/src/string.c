@@ -4,9 +4,13 @@
  * SPDX-License-Identifier: GPL-2.0-only
  */
 
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
 #include <strops.h>
 #include <printf.h>
 #include <abort.h>
+#include <primitives.h>
 
 #define BYTE_PER_WORD   sizeof(word_t)
 
@@ -25,6 +29,11 @@
 typedef word_t __attribute__((__may_alias__)) u_alias;
 #endif
 
+/* memset() and memcpy() call the default variants below, so keep the compiler
+ * from turning their loops back into memset() and memcpy() calls.
+ */
+#define HIDE_LOOP(p) asm("" : "+r"(p))
+
 size_t strlen(const char *str)
 {
     const char *s;
@@ -65,6 +74,11 @@ void *memset(void *s, int c, size_t n)
 {
     char *mem = (char *)s;
 
+    if ((unsigned char)c == 0) {
+        memzero(s, n);
+        return s;
+    }
+
 #ifdef HAS_MAY_ALIAS
     /* fill byte by byte until word aligned */
     for (; (uintptr_t)mem % BYTE_PER_WORD != 0 && n > 0; mem++, n--) {
@@ -94,6 +108,22 @@ void *memset(void *s, int c, size_t n)
     return s;
 }
 
+void *memcpy(void *restrict dest, const void *restrict src, size_t n)
+{
+    return primitives.memcpy(dest, src, n);
+}
+
+void memzero(void *s, size_t n)
+{
+    primitives.memzero(s, n);
+}
+
+/* On ARM, memmove(), default_memcpy() and default_memzero() are in
+ * src/arch-arm/<word size>/string.S, as they need to cope with unaligned
+ * sources without unaligned accesses.
+ */
+#ifndef CONFIG_ARCH_ARM
+
 void *memmove(void *restrict dest, const void *restrict src, size_t n)
 {
     unsigned char *d = (unsigned char *)dest;
@@ -121,7 +151,7 @@ void *memmove(void *restrict dest, const void *restrict src, size_t n)
     return dest;
 }
 
-void *memcpy(void *restrict dest, const void *restrict src, size_t n)
+void *default_memcpy(void *restrict dest, const void *restrict src, size_t n)
 {
     unsigned char *d = (unsigned char *)dest;
     const unsigned char *s = (const unsigned char *)src;
@@ -149,6 +179,7 @@ void *memcpy(void *restrict dest, const void *restrict src, size_t n)
     /* copy byte by byte until copy-unit aligned */
     for (; (uintptr_t)d % copy_unit != 0 && n > 0; d++, s++, n--) {
         *d = *s;
+        HIDE_LOOP(d);
     }
     /* copy unit by unit as long as we can */
     for (; n > copy_unit - 1; n -= copy_unit, s += copy_unit, d += copy_unit) {
@@ -169,17 +200,58 @@ void *memcpy(void *restrict dest, const void *restrict src, size_t n)
             printf("Invalid copy unit %ld\n", copy_unit);
             abort();
         }
+        HIDE_LOOP(d);
     }
     /* copy any remainder byte by byte */
     for (; n > 0; d++, s++, n--) {
         *d = *s;
+        HIDE_LOOP(d);
     }
 #else
     size_t i;
     for (i = 0; i < n; i++) {
         d[i] = s[i];
+        HIDE_LOOP(d);
     }
 #endif
 
     return dest;
 }
+
+void default_memzero(void *s, size_t n)
+{
+    char *mem = (char *)s;
+    char *end = mem + n;
+
+#ifdef HAS_MAY_ALIAS
+    /* zero byte by byte until word aligned */
+    for (; (uintptr_t)mem % BYTE_PER_WORD != 0 && mem < end; mem++) {
+        *mem = 0;
+        HIDE_LOOP(mem);
+    }
+    /* eight words per iteration */
+    for (; (size_t)(end - mem) >= 8 * BYTE_PER_WORD; mem += 8 * BYTE_PER_WORD) {
+        u_alias *word = (u_alias *)mem;
+        word[0] = 0;
+        word[1] = 0;
+        word[2] = 0;
+        word[3] = 0;
+        word[4] = 0;
+        word[5] = 0;
+        word[6] = 0;
+        word[7] = 0;
+        HIDE_LOOP(mem);
+    }
+    for (; (size_t)(end - mem) >= BYTE_PER_WORD; mem += BYTE_PER_WORD) {
+        *(u_alias *)mem = 0;
+        HIDE_LOOP(mem);
+    }
+#endif
+    /* zero any remainder byte by byte */
+    for (; mem < end; mem++) {
+        *mem = 0;
+        HIDE_LOOP(mem);
+    }
+}
+
+#endif /* !CONFIG_ARCH_ARM */
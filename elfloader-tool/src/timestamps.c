@@ -0,0 +1,319 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+#include <printf.h>
+#include <fdt.h>
+#include <elfloader_common.h>
+
+#include "timestamps.h"
+
+struct timestamp {
+    uint8_t phase;
+    int8_t image; /* index into 'images', -1 for none */
+    uint64_t start;
+    uint64_t end;
+    uint64_t bytes;
+};
+
+/*
+ * The image names are copied, the archive they come from may be gone or
+ * somewhere else when the table is printed at the end. The phase names are
+ * looked up by index for the same reason.
+ */
+static char const *const phase_names[TIMESTAMP_NUM_PHASES] = {
+    [TIMESTAMP_INITIALISE_DEVICES] = "initialise_devices",
+    [TIMESTAMP_LOAD_IMAGES] = "load_images",
+    [TIMESTAMP_LOOKUP] = "lookup",
+    [TIMESTAMP_HASH] = "hash",
+    [TIMESTAMP_COPY] = "copy",
+    [TIMESTAMP_ZERO] = "zero",
+    [TIMESTAMP_INIT_BOOT_VSPACE] = "init_boot_vspace",
+    [TIMESTAMP_SMP_BOOT] = "smp_boot",
+    [TIMESTAMP_MMU_ENABLE] = "mmu_enable",
+};
+
+static struct timestamp timestamps[TIMESTAMPS_MAX];
+static unsigned int num_timestamps;
+/* The kernel and the user images. */
+static char images[CONFIG_ELFLOADER_ROOTSERVER_IMAGES + 1]
+                  [TIMESTAMP_IMAGE_NAME_LEN];
+static unsigned int num_images;
+static int current_image = -1;
+
+/* Read by timestamps_export(), the DTB may no longer be accessible when the
+ * table is printed.
+ */
+static uint64_t counter_freq;
+
+void timestamp_image(char const *name)
+{
+    if (!name || (num_images == ARRAY_SIZE(images))) {
+        current_image = -1;
+        return;
+    }
+
+    current_image = num_images++;
+    size_t len = MIN(strlen(name), TIMESTAMP_IMAGE_NAME_LEN - 1);
+    memcpy(images[current_image], name, len);
+    images[current_image][len] = '\0';
+}
+
+int timestamp_begin(enum timestamp_phase phase)
+{
+    if (num_timestamps == ARRAY_SIZE(timestamps)) {
+        return -1;
+    }
+
+    struct timestamp *ts = &timestamps[num_timestamps];
+    ts->phase = phase;
+    ts->image = current_image;
+    ts->start = timestamp_read();
+    return num_timestamps++;
+}
+
+void timestamp_end(int slot, uint64_t bytes)
+{
+    if (slot < 0) {
+        return;
+    }
+
+    timestamps[slot].end = timestamp_read();
+    timestamps[slot].bytes = bytes;
+}
+
+/* Length of the "image:phase" name of a phase, without the terminator. */
+static size_t get_name_len(struct timestamp const *ts)
+{
+    size_t len = strlen(phase_names[ts->phase]);
+    if (ts->image >= 0) {
+        len += strlen(images[ts->image]) + 1;
+    }
+    return len;
+}
+
+/* Whether the 'len' characters at 'key' are the phase or "image:phase". */
+static int is_phase(struct timestamp const *ts, char const *key, size_t len)
+{
+    char const *phase = phase_names[ts->phase];
+
+    if ((len == strlen(phase)) && (0 == strncmp(key, phase, len))) {
+        return 1;
+    }
+    if ((ts->image < 0) || (len != get_name_len(ts))) {
+        return 0;
+    }
+    size_t image_len = strlen(images[ts->image]);
+    return (0 == strncmp(key, images[ts->image], image_len)) &&
+           (key[image_len] == ':') &&
+           (0 == strncmp(key + image_len + 1, phase, strlen(phase)));
+}
+
+static void print_name(struct timestamp const *ts)
+{
+    if (ts->image >= 0) {
+        printf("%s:", images[ts->image]);
+    }
+    printf("%s", phase_names[ts->phase]);
+}
+
+/*
+ * The budget of a phase in microseconds, 0 if it has none. The budgets are a
+ * comma separated list of "phase=us", where phase is a phase of the table
+ * like "smp_boot" or "copy", or the phase of one image like "kernel.elf:copy".
+ * The budget of the phase of one image goes before the one of all images.
+ */
+static uint64_t get_budget(struct timestamp const *ts)
+{
+    char const *list = CONFIG_ELFLOADER_BOOT_TIMESTAMP_BUDGETS;
+    uint64_t phase_budget = 0;
+
+    while (*list != '\0') {
+        char const *key = list;
+        for (; (*list != '\0') && (*list != '=') && (*list != ','); list++);
+        size_t key_len = list - key;
+        uint64_t budget = 0;
+        if (*list == '=') {
+            for (list++; (*list >= '0') && (*list <= '9'); list++) {
+                budget = budget * 10 + (*list - '0');
+            }
+        }
+        for (; (*list != '\0') && (*list != ','); list++);
+        if (*list == ',') {
+            list++;
+        }
+        if (!is_phase(ts, key, key_len)) {
+            continue;
+        }
+        if (key_len == get_name_len(ts)) {
+            return budget;
+        }
+        if (!phase_budget) {
+            phase_budget = budget;
+        }
+    }
+
+    return phase_budget;
+}
+
+/* Counter ticks in microseconds, without overflowing for long times. */
+static uint64_t ticks_to_us(uint64_t ticks, uint64_t freq)
+{
+    return (ticks / freq) * 1000000 + ((ticks % freq) * 1000000) / freq;
+}
+
+void timestamps_print(void)
+{
+    uint64_t freq = counter_freq ? counter_freq : timestamp_frequency(NULL);
+
+    if ((num_timestamps == 0) || (timestamps[0].start == 0)) {
+        printf("No boot timestamps, the CPU has no counter\n");
+        return;
+    }
+    if (freq == 0) {
+        printf("Boot timestamps, in counter ticks of unknown frequency:\n");
+    } else {
+        printf("Boot timestamps, counter at %"PRIu64" Hz, started at %"PRIu64
+               " us:\n", freq, ticks_to_us(timestamps[0].start, freq));
+    }
+
+    uint64_t last_end = 0;
+    for (unsigned int i = 0; i < num_timestamps; i++) {
+        struct timestamp const *ts = &timestamps[i];
+        if (ts->end == 0) {
+            continue;
+        }
+        if (ts->end > last_end) {
+            last_end = ts->end;
+        }
+
+        printf("  ");
+        print_name(ts);
+        if (freq == 0) {
+            printf(": %"PRIu64" ticks\n", ts->end - ts->start);
+            continue;
+        }
+
+        uint64_t us = ticks_to_us(ts->end - ts->start, freq);
+        printf(": %"PRIu64" us", us);
+        if (ts->bytes) {
+            printf(", %"PRIu64" bytes", ts->bytes);
+            /* Bytes per microsecond are MB/s. */
+            if (us) {
+                printf(", %"PRIu64" MB/s", ts->bytes / us);
+            }
+        }
+        printf("\n");
+
+        uint64_t budget = get_budget(ts);
+        if (budget && (us > budget)) {
+            printf("WARNING: ");
+            print_name(ts);
+            printf(" took %"PRIu64" us, its budget is %"PRIu64" us\n", us,
+                   budget);
+        }
+    }
+
+    if (freq && last_end) {
+        printf("  total: %"PRIu64" us\n",
+               ticks_to_us(last_end - timestamps[0].start, freq));
+    }
+}
+
+/* Store 'val' big endian, property values are only 4-byte aligned. */
+static void put_be64(void *p, uint64_t val)
+{
+    uint8_t *out = p;
+
+    for (int i = 7; i >= 0; i--) {
+        out[i] = val & 0xff;
+        val >>= 8;
+    }
+}
+
+/* The properties added to /chosen, in the order they are added. */
+static char const *const prop_names[] = {
+    "elfloader,timestamp-frequency",
+    "elfloader,timestamp-names",
+    "elfloader,timestamps",
+};
+
+/*
+ * Adding a property moves the ones added before, so each value is filled in
+ * right away. The space for all of them is checked first, so that the DTB has
+ * either all of them or none.
+ */
+int timestamps_export(void *dtb)
+{
+    counter_freq = timestamp_frequency(dtb);
+
+    unsigned int count = 0;
+    size_t names_size = 0;
+
+    for (unsigned int i = 0; i < num_timestamps; i++) {
+        if (timestamps[i].end != 0) {
+            count++;
+            names_size += get_name_len(&timestamps[i]) + 1;
+        }
+    }
+
+    /* Each property has a token, its length and the offset of its name. The
+     * name may have to be added, too, and a node for /chosen.
+     */
+    size_t space = 8 + ROUND_UP(names_size, 2) + count * 16 + 16;
+    for (unsigned int i = 0; i < ARRAY_SIZE(prop_names); i++) {
+        space += 12 + strlen(prop_names[i]) + 1;
+    }
+    if (space > fdt_free_space(dtb)) {
+        printf("WARNING: no space for the boot timestamps in the DTB\n");
+        return -1;
+    }
+
+    uint8_t *value = fdt_add_chosen_prop(dtb, prop_names[0], 8);
+    if (!value) {
+        return -1;
+    }
+    put_be64(value, counter_freq);
+
+    char *names = fdt_add_chosen_prop(dtb, prop_names[1], names_size);
+    if (!names) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < num_timestamps; i++) {
+        struct timestamp const *ts = &timestamps[i];
+        if (ts->end == 0) {
+            continue;
+        }
+        if (ts->image >= 0) {
+            size_t len = strlen(images[ts->image]);
+            memcpy(names, images[ts->image], len);
+            names[len] = ':';
+            names += len + 1;
+        }
+        size_t len = strlen(phase_names[ts->phase]) + 1;
+        memcpy(names, phase_names[ts->phase], len);
+        names += len;
+    }
+
+    value = fdt_add_chosen_prop(dtb, prop_names[2], count * 16);
+    if (!value) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < num_timestamps; i++) {
+        struct timestamp const *ts = &timestamps[i];
+        if (ts->end != 0) {
+            put_be64(value, ts->start);
+            put_be64(value + 8, ts->end);
+            value += 16;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <elfloader_common.h>
+
+/* The phases of the boot that are timed. The ones from TIMESTAMP_LOOKUP to
+ * TIMESTAMP_ZERO are recorded for each image.
+ */
+enum timestamp_phase {
+    TIMESTAMP_INITIALISE_DEVICES,
+    TIMESTAMP_LOAD_IMAGES,
+    TIMESTAMP_LOOKUP,
+    TIMESTAMP_HASH,
+    TIMESTAMP_COPY,
+    TIMESTAMP_ZERO,
+    TIMESTAMP_INIT_BOOT_VSPACE,
+    TIMESTAMP_SMP_BOOT,
+    TIMESTAMP_MMU_ENABLE,
+    TIMESTAMP_NUM_PHASES
+};
+
+#ifdef CONFIG_ELFLOADER_BOOT_TIMESTAMPS
+
+/*
+ * The boot core records the start and end of each phase in a fixed table,
+ * using the free-running counter of the CPU. timestamps_print() prints the
+ * table with the durations and throughput, and warns about phases that took
+ * longer than their budget from CONFIG_ELFLOADER_BOOT_TIMESTAMP_BUDGETS.
+ * timestamps_export() adds the table to /chosen of the DTB for the kernel:
+ *
+ *   elfloader,timestamp-frequency  counter frequency in Hz, a u64
+ *   elfloader,timestamp-names      "phase" or "image:phase" for each phase
+ *   elfloader,timestamps           start and end count of each phase, u64s
+ */
+
+/* Number of phases the table can hold. */
+#define TIMESTAMPS_MAX  (8 + 4 * (CONFIG_ELFLOADER_ROOTSERVER_IMAGES + 1))
+
+/* Longest image name that is kept, longer ones are cut. */
+#define TIMESTAMP_IMAGE_NAME_LEN    32
+
+/* Free space the ELF-loader leaves at the end of the DTB it copies, enough for
+ * the table with names up to the limit above.
+ */
+#define TIMESTAMPS_DTB_SPACE    (256 + TIMESTAMPS_MAX * \
+                                 (16 + TIMESTAMP_IMAGE_NAME_LEN + 20))
+
+/* The counter and its frequency in Hz, 0 if not known. Implemented by each
+ * architecture. The counter reads as 0 if the CPU does not have one.
+ */
+uint64_t timestamp_read(void);
+uint64_t timestamp_frequency(void const *dtb);
+
+/* The phases started from now on belong to the image 'name', or to none if
+ * 'name' is NULL.
+ */
+void timestamp_image(char const *name);
+
+/* Start a phase. Returns its slot in the table, or -1 if the table is full. */
+int timestamp_begin(enum timestamp_phase phase);
+
+/* End the phase in 'slot', 'bytes' is the amount of data it has processed or 0
+ * if its throughput does not matter.
+ */
+void timestamp_end(int slot, uint64_t bytes);
+
+/* Add the phases that have ended to /chosen of 'dtb'. Returns 0 on success. */
+int timestamps_export(void *dtb);
+
+/* Print the table, with the counter frequency timestamps_export() has found in
+ * the DTB if the CPU does not tell it.
+ */
+void timestamps_print(void);
+
+#else /* not CONFIG_ELFLOADER_BOOT_TIMESTAMPS */
+
+#define TIMESTAMPS_DTB_SPACE    0
+
+static inline void timestamp_image(UNUSED char const *name) {}
+
+static inline int timestamp_begin(UNUSED enum timestamp_phase phase)
+{
+    return -1;
+}
+
+static inline void timestamp_end(UNUSED int slot, UNUSED uint64_t bytes) {}
+static inline int timestamps_export(UNUSED void *dtb)
+{
+    return 0;
+}
+
+static inline void timestamps_print(void) {}
+
+#endif /* [not] CONFIG_ELFLOADER_BOOT_TIMESTAMPS */
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*
+ * BLAKE2s-256 implementation based on RFC 7693. It works on 32-bit words with
+ * additions, rotations and XORs only, so it is fast on small cores that have
+ * no crypto extensions and must not use FP/SIMD registers.
+ */
+#include <types.h>
+#include <strops.h>
+
+#include "../crypt_blake2s.h"
+
+static const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint8_t SIGMA[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+};
+
+static uint32_t ror(uint32_t n, int k)
+{
+    return (n >> k) | (n << (32 - k));
+}
+
+static uint32_t load32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+#define G(a, b, c, d, x, y)             \
+    do {                                \
+        v[a] = v[a] + v[b] + (x);       \
+        v[d] = ror(v[d] ^ v[a], 16);    \
+        v[c] = v[c] + v[d];             \
+        v[b] = ror(v[b] ^ v[c], 12);    \
+        v[a] = v[a] + v[b] + (y);       \
+        v[d] = ror(v[d] ^ v[a], 8);     \
+        v[c] = v[c] + v[d];             \
+        v[b] = ror(v[b] ^ v[c], 7);     \
+    } while (0)
+
+static void processblock(blake2s_t *s, const uint8_t *buf, int is_last)
+{
+    uint32_t m[16], v[16];
+    int i;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (!((uintptr_t)buf & 3)) {
+        for (i = 0; i < 16; i++) {
+            m[i] = ((const uint32_t *)buf)[i];
+        }
+    } else
+#endif
+    {
+        for (i = 0; i < 16; i++) {
+            m[i] = load32(buf + 4 * i);
+        }
+    }
+
+    for (i = 0; i < 8; i++) {
+        v[i] = s->h[i];
+        v[i + 8] = IV[i];
+    }
+    v[12] ^= s->t[0];
+    v[13] ^= s->t[1];
+    if (is_last) {
+        v[14] = ~v[14];
+    }
+
+    for (i = 0; i < 10; i++) {
+        const uint8_t *sigma = SIGMA[i];
+        G(0, 4,  8, 12, m[sigma[0]], m[sigma[1]]);
+        G(1, 5,  9, 13, m[sigma[2]], m[sigma[3]]);
+        G(2, 6, 10, 14, m[sigma[4]], m[sigma[5]]);
+        G(3, 7, 11, 15, m[sigma[6]], m[sigma[7]]);
+        G(0, 5, 10, 15, m[sigma[8]], m[sigma[9]]);
+        G(1, 6, 11, 12, m[sigma[10]], m[sigma[11]]);
+        G(2, 7,  8, 13, m[sigma[12]], m[sigma[13]]);
+        G(3, 4,  9, 14, m[sigma[14]], m[sigma[15]]);
+    }
+
+    for (i = 0; i < 8; i++) {
+        s->h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+static void add_len(blake2s_t *s, uint32_t len)
+{
+    s->t[0] += len;
+    if (s->t[0] < len) {
+        s->t[1]++;
+    }
+}
+
+void blake2s_init(blake2s_t *s)
+{
+    for (int i = 0; i < 8; i++) {
+        s->h[i] = IV[i];
+    }
+    /* no key, 32 bytes of output */
+    s->h[0] ^= 0x01010000 | 32;
+    s->t[0] = 0;
+    s->t[1] = 0;
+    s->buflen = 0;
+}
+
+void blake2s_sum(blake2s_t *s, uint8_t *md)
+{
+    add_len(s, s->buflen);
+    memset(s->buf + s->buflen, 0, 64 - s->buflen);
+    processblock(s, s->buf, 1);
+
+    for (int i = 0; i < 8; i++) {
+        md[4 * i] = s->h[i];
+        md[4 * i + 1] = s->h[i] >> 8;
+        md[4 * i + 2] = s->h[i] >> 16;
+        md[4 * i + 3] = s->h[i] >> 24;
+    }
+}
+
+void blake2s_update(blake2s_t *s, const void *m, unsigned long len)
+{
+    const uint8_t *p = m;
+
+    if (len == 0) {
+        return;
+    }
+
+    /* The last block is processed differently, so a full buffer is only
+     * processed once more data follows.
+     */
+    if (s->buflen) {
+        unsigned long n = 64 - s->buflen;
+        if (len <= n) {
+            memcpy(s->buf + s->buflen, p, len);
+            s->buflen += len;
+            return;
+        }
+        memcpy(s->buf + s->buflen, p, n);
+        add_len(s, 64);
+        processblock(s, s->buf, 0);
+        s->buflen = 0;
+        p += n;
+        len -= n;
+    }
+
+    for (; len > 64; len -= 64, p += 64) {
+        add_len(s, 64);
+        processblock(s, p, 0);
+    }
+
+    memcpy(s->buf, p, len);
+    s->buflen = len;
+}
@@ -21,6 +21,7 @@
 #include <strops.h>
 #include <printf.h>
 #include <types.h>
+#include <elfloader_common.h>
 #include "../crypt_md5.h"
 
 /* public domain md5 implementation based on rfc1321 and libtomcrypt */
@@ -49,15 +50,48 @@ static const uint32_t tab[64] = {
     0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
 };
 
+/* Load a little endian word. */
+static uint32_t load_le32(const uint8_t *p)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (IS_ALIGNED((uintptr_t)p, 2)) {
+        return *(const uint32_t *)p;
+    }
+#endif
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+#define FF4(i) \
+    FF(a, b, c, d, W[(i)],      7, tab[(i)]); \
+    FF(d, a, b, c, W[(i) + 1], 12, tab[(i) + 1]); \
+    FF(c, d, a, b, W[(i) + 2], 17, tab[(i) + 2]); \
+    FF(b, c, d, a, W[(i) + 3], 22, tab[(i) + 3])
+#define GG4(i) \
+    GG(a, b, c, d, W[(5 * (i) + 1) % 16],  5, tab[(i)]); \
+    GG(d, a, b, c, W[(5 * (i) + 6) % 16],  9, tab[(i) + 1]); \
+    GG(c, d, a, b, W[(5 * (i) + 11) % 16], 14, tab[(i) + 2]); \
+    GG(b, c, d, a, W[(5 * (i) + 16) % 16], 20, tab[(i) + 3])
+#define HH4(i) \
+    HH(a, b, c, d, W[(3 * (i) + 5) % 16],  4, tab[(i)]); \
+    HH(d, a, b, c, W[(3 * (i) + 8) % 16], 11, tab[(i) + 1]); \
+    HH(c, d, a, b, W[(3 * (i) + 11) % 16], 16, tab[(i) + 2]); \
+    HH(b, c, d, a, W[(3 * (i) + 14) % 16], 23, tab[(i) + 3])
+#define II4(i) \
+    II(a, b, c, d, W[(7 * (i)) % 16],  6, tab[(i)]); \
+    II(d, a, b, c, W[(7 * (i) + 7) % 16], 10, tab[(i) + 1]); \
+    II(c, d, a, b, W[(7 * (i) + 14) % 16], 15, tab[(i) + 2]); \
+    II(b, c, d, a, W[(7 * (i) + 21) % 16], 21, tab[(i) + 3])
+
 static void processblock(md5_t *s, const uint8_t *buf)
 {
     uint32_t i, W[16], a, b, c, d;
 
+    /* All indices below are constants, so the rounds are fully unrolled and
+     * the words can stay in registers where the target has enough of them.
+     */
     for (i = 0; i < 16; i++) {
-        W[i] = buf[4 * i];
-        W[i] |= (uint32_t)buf[4 * i + 1] << 8;
-        W[i] |= (uint32_t)buf[4 * i + 2] << 16;
-        W[i] |= (uint32_t)buf[4 * i + 3] << 24;
+        W[i] = load_le32(buf + 4 * i);
     }
 
     a = s->h[0];
@@ -65,47 +99,22 @@ static void processblock(md5_t *s, const uint8_t *buf)
     c = s->h[2];
     d = s->h[3];
 
-    i = 0;
-    while (i < 16) {
-        FF(a, b, c, d, W[i],  7, tab[i]);
-        i++;
-        FF(d, a, b, c, W[i], 12, tab[i]);
-        i++;
-        FF(c, d, a, b, W[i], 17, tab[i]);
-        i++;
-        FF(b, c, d, a, W[i], 22, tab[i]);
-        i++;
-    }
-    while (i < 32) {
-        GG(a, b, c, d, W[(5 * i + 1) % 16],  5, tab[i]);
-        i++;
-        GG(d, a, b, c, W[(5 * i + 1) % 16],  9, tab[i]);
-        i++;
-        GG(c, d, a, b, W[(5 * i + 1) % 16], 14, tab[i]);
-        i++;
-        GG(b, c, d, a, W[(5 * i + 1) % 16], 20, tab[i]);
-        i++;
-    }
-    while (i < 48) {
-        HH(a, b, c, d, W[(3 * i + 5) % 16],  4, tab[i]);
-        i++;
-        HH(d, a, b, c, W[(3 * i + 5) % 16], 11, tab[i]);
-        i++;
-        HH(c, d, a, b, W[(3 * i + 5) % 16], 16, tab[i]);
-        i++;
-        HH(b, c, d, a, W[(3 * i + 5) % 16], 23, tab[i]);
-        i++;
-    }
-    while (i < 64) {
-        II(a, b, c, d, W[7 * i % 16],  6, tab[i]);
-        i++;
-        II(d, a, b, c, W[7 * i % 16], 10, tab[i]);
-        i++;
-        II(c, d, a, b, W[7 * i % 16], 15, tab[i]);
-        i++;
-        II(b, c, d, a, W[7 * i % 16], 21, tab[i]);
-        i++;
-    }
+    FF4(0);
+    FF4(4);
+    FF4(8);
+    FF4(12);
+    GG4(16);
+    GG4(20);
+    GG4(24);
+    GG4(28);
+    HH4(32);
+    HH4(36);
+    HH4(40);
+    HH4(44);
+    II4(48);
+    II4(52);
+    II4(56);
+    II4(60);
 
     s->h[0] += a;
     s->h[1] += b;
@@ -19,9 +19,14 @@
  * in the salt and rounds= setting must contain a valid iteration count,
  * on error "*" is returned.
  */
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
 #include <printf.h>
 #include <types.h>
 #include <strops.h>
+#include <elfloader_common.h>
+#include <primitives.h>
 
 #include "../crypt_sha256.h"
 
@@ -33,16 +38,47 @@
 
 /* public domain sha256 implementation based on fips180-3 */
 
+#define Ch(x,y,z)  (z ^ (x & (y ^ z)))
+#define Maj(x,y,z) ((x & y) | (z & (x | y)))
+
 static uint32_t ror(uint32_t n, int k)
 {
     return (n >> k) | (n << (32 - k));
 }
-#define Ch(x,y,z)  (z ^ (x & (y ^ z)))
-#define Maj(x,y,z) ((x & y) | (z & (x | y)))
-#define S0(x)      (ror(x,2) ^ ror(x,13) ^ ror(x,22))
-#define S1(x)      (ror(x,6) ^ ror(x,11) ^ ror(x,25))
-#define R0(x)      (ror(x,7) ^ ror(x,18) ^ (x>>3))
-#define R1(x)      (ror(x,17) ^ ror(x,19) ^ (x>>10))
+
+#ifdef CONFIG_ELFLOADER_SHA256_RISCV_ZKNH
+
+/* The sigma functions are single instructions of the RISC-V Zknh extension.
+ * They are encoded with .insn, so the toolchain does not need to support it.
+ * On RV64 they use the lower 32 bits of the source register.
+ */
+#define ZKNH_OP(name, imm) \
+    static inline uint32_t name(uint32_t x) \
+    { \
+        word_t r; \
+        asm(".insn i 0x13, 1, %0, %1, " #imm : "=r"(r) : "r"((word_t)x)); \
+        return r; \
+    }
+ZKNH_OP(sha256sum0, 0x100)
+ZKNH_OP(sha256sum1, 0x101)
+ZKNH_OP(sha256sig0, 0x102)
+ZKNH_OP(sha256sig1, 0x103)
+
+/* processblock() is inlined with a constant 'zknh', so each variant has just
+ * one of the two.
+ */
+#define SIGMA(op, x, expr) (zknh ? op(x) : (expr))
+
+#else /* not CONFIG_ELFLOADER_SHA256_RISCV_ZKNH */
+
+#define SIGMA(op, x, expr) (expr)
+
+#endif /* CONFIG_ELFLOADER_SHA256_RISCV_ZKNH */
+
+#define S0(x)      SIGMA(sha256sum0, x, ror(x,2) ^ ror(x,13) ^ ror(x,22))
+#define S1(x)      SIGMA(sha256sum1, x, ror(x,6) ^ ror(x,11) ^ ror(x,25))
+#define R0(x)      SIGMA(sha256sig0, x, ror(x,7) ^ ror(x,18) ^ (x>>3))
+#define R1(x)      SIGMA(sha256sig1, x, ror(x,17) ^ ror(x,19) ^ (x>>10))
 
 static const uint32_t K[64] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
@@ -55,48 +91,94 @@ static const uint32_t K[64] = {
     0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
-static void processblock(sha256_t *s, const uint8_t *buf)
+/* Load a big endian word. GCC turns this into a single load and a byte swap,
+ * if the target has one.
+ */
+static uint32_t load_be32(const uint8_t *p)
 {
-    uint32_t W[64], t1, t2, a, b, c, d, e, f, g, h;
-    int i;
-
-    for (i = 0; i < 16; i++) {
-        W[i] = (uint32_t)buf[4 * i] << 24;
-        W[i] |= (uint32_t)buf[4 * i + 1] << 16;
-        W[i] |= (uint32_t)buf[4 * i + 2] << 8;
-        W[i] |= buf[4 * i + 3];
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (IS_ALIGNED((uintptr_t)p, 2)) {
+        uint32_t x = *(const uint32_t *)p;
+        return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) |
+               (x << 24);
     }
-    for (; i < 64; i++) {
-        W[i] = R1(W[i - 2]) + W[i - 7] + R0(W[i - 15]) + W[i - 16];
+#endif
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* The schedule only keeps the last 16 words. W[i & 15] is replaced with the
+ * word for round i just before it is needed.
+ */
+#define W_LOAD(i)   (W[i] = load_be32(buf + 4 * (i)))
+#define W_SCHED(i)  (W[(i) & 15] += R1(W[((i) - 2) & 15]) + \
+                                    W[((i) - 7) & 15] + R0(W[((i) - 15) & 15]))
+
+#define ROUND(a,b,c,d,e,f,g,h,i,w) \
+    t1 = h + S1(e) + Ch(e,f,g) + K[i] + (w); \
+    d += t1; \
+    h = t1 + S0(a) + Maj(a,b,c)
+
+#define ROUNDS8(i,WF) \
+    ROUND(a,b,c,d,e,f,g,h,(i),WF(i)); \
+    ROUND(h,a,b,c,d,e,f,g,(i)+1,WF((i)+1)); \
+    ROUND(g,h,a,b,c,d,e,f,(i)+2,WF((i)+2)); \
+    ROUND(f,g,h,a,b,c,d,e,(i)+3,WF((i)+3)); \
+    ROUND(e,f,g,h,a,b,c,d,(i)+4,WF((i)+4)); \
+    ROUND(d,e,f,g,h,a,b,c,(i)+5,WF((i)+5)); \
+    ROUND(c,d,e,f,g,h,a,b,(i)+6,WF((i)+6)); \
+    ROUND(b,c,d,e,f,g,h,a,(i)+7,WF((i)+7))
+
+static inline __attribute__((always_inline)) void processblock(uint32_t H[8], const uint8_t *buf, int zknh)
+{
+    uint32_t W[16], t1, a, b, c, d, e, f, g, h;
+
+    (void)zknh;
+    a = H[0];
+    b = H[1];
+    c = H[2];
+    d = H[3];
+    e = H[4];
+    f = H[5];
+    g = H[6];
+    h = H[7];
+    ROUNDS8(0, W_LOAD);
+    ROUNDS8(8, W_LOAD);
+    ROUNDS8(16, W_SCHED);
+    ROUNDS8(24, W_SCHED);
+    ROUNDS8(32, W_SCHED);
+    ROUNDS8(40, W_SCHED);
+    ROUNDS8(48, W_SCHED);
+    ROUNDS8(56, W_SCHED);
+    H[0] += a;
+    H[1] += b;
+    H[2] += c;
+    H[3] += d;
+    H[4] += e;
+    H[5] += f;
+    H[6] += g;
+    H[7] += h;
+}
+
+void sha256_blocks_generic(uint32_t h[8], const uint8_t *data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += 64) {
+        processblock(h, data, 0);
     }
-    a = s->h[0];
-    b = s->h[1];
-    c = s->h[2];
-    d = s->h[3];
-    e = s->h[4];
-    f = s->h[5];
-    g = s->h[6];
-    h = s->h[7];
-    for (i = 0; i < 64; i++) {
-        t1 = h + S1(e) + Ch(e, f, g) + K[i] + W[i];
-        t2 = S0(a) + Maj(a, b, c);
-        h = g;
-        g = f;
-        f = e;
-        e = d + t1;
-        d = c;
-        c = b;
-        b = a;
-        a = t1 + t2;
+}
+
+#ifdef CONFIG_ELFLOADER_SHA256_RISCV_ZKNH
+void sha256_blocks_zknh(uint32_t h[8], const uint8_t *data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += 64) {
+        processblock(h, data, 1);
     }
-    s->h[0] += a;
-    s->h[1] += b;
-    s->h[2] += c;
-    s->h[3] += d;
-    s->h[4] += e;
-    s->h[5] += f;
-    s->h[6] += g;
-    s->h[7] += h;
+}
+#endif
+
+static void processblocks(sha256_t *s, const uint8_t *buf, size_t blocks)
+{
+    primitives.sha256_blocks(s->h, buf, blocks);
 }
 
 static void pad(sha256_t *s)
@@ -107,7 +189,7 @@ static void pad(sha256_t *s)
     if (r > 56) {
         memset(s->buf + r, 0, 64 - r);
         r = 0;
-        processblock(s, s->buf);
+        processblocks(s, s->buf, 1);
     }
     memset(s->buf + r, 0, 56 - r);
     s->len *= 8;
@@ -119,7 +201,7 @@ static void pad(sha256_t *s)
     s->buf[61] = s->len >> 16;
     s->buf[62] = s->len >> 8;
     s->buf[63] = s->len;
-    processblock(s, s->buf);
+    processblocks(s, s->buf, 1);
 }
 
 void sha256_init(sha256_t *s)
@@ -162,10 +244,12 @@ void sha256_update(sha256_t *s, const void *m, unsigned long len)
         memcpy(s->buf + r, p, 64 - r);
         len -= 64 - r;
         p += 64 - r;
-        processblock(s, s->buf);
+        processblocks(s, s->buf, 1);
     }
-    for (; len >= 64; len -= 64, p += 64) {
-        processblock(s, p);
+    if (len >= 64) {
+        processblocks(s, p, len / 64);
+        p += len & ~63UL;
+        len &= 63;
     }
     memcpy(s->buf, p, len);
 }
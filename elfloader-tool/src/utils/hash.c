@@ -15,6 +15,82 @@
 
 #include "../hash.h"
 
+/* Start a new incremental hash calculation.
+ *
+ * The hash_type member of 'hashes' selects the algorithm. This together with
+ * hash_update() and hash_final() allows hashing data that is not available in
+ * one contiguous block, e.g. when it is hashed piece by piece while being
+ * copied.
+ */
+void hash_init(
+    hashes_t *hashes)
+{
+    switch (hashes->hash_type) {
+    case SHA_256:
+        sha256_init(&hashes->sha_structure);
+        break;
+    case BLAKE2S:
+        blake2s_init(&hashes->blake2s_structure);
+        break;
+    case CRC32C:
+        crc32c_init(&hashes->crc32c_structure);
+        break;
+    default:
+        md5_init(&hashes->md5_structure);
+        break;
+    }
+}
+
+void hash_init_config(
+    hashes_t *hashes)
+{
+    hashes->hash_type = HASH_CONFIG_TYPE;
+    hash_init(hashes);
+}
+
+/* Feed more data into a hash calculation started with hash_init(). */
+void hash_update(
+    hashes_t *hashes,
+    const void *data,
+    size_t len)
+{
+    switch (hashes->hash_type) {
+    case SHA_256:
+        sha256_update(&hashes->sha_structure, data, len);
+        break;
+    case BLAKE2S:
+        blake2s_update(&hashes->blake2s_structure, data, len);
+        break;
+    case CRC32C:
+        crc32c_update(&hashes->crc32c_structure, data, len);
+        break;
+    default:
+        md5_update(&hashes->md5_structure, data, len);
+        break;
+    }
+}
+
+/* Finish a hash calculation and store the result in outputted_hash. */
+void hash_final(
+    hashes_t *hashes,
+    void *outputted_hash)
+{
+    switch (hashes->hash_type) {
+    case SHA_256:
+        sha256_sum(&hashes->sha_structure, outputted_hash);
+        break;
+    case BLAKE2S:
+        blake2s_sum(&hashes->blake2s_structure, outputted_hash);
+        break;
+    case CRC32C:
+        crc32c_sum(&hashes->crc32c_structure, outputted_hash);
+        break;
+    default:
+        md5_sum(&hashes->md5_structure, outputted_hash);
+        break;
+    }
+}
+
 /* Function to perform all hash operations.
  *
  * The outputted hash is stored in the outputted_hash pointer after the "sum"
@@ -27,17 +103,9 @@ void get_hash(
     size_t len,
     void *outputted_hash)
 {
-    if (hashes.hash_type == SHA_256) {
-        sha256_t calculated_hash = hashes.sha_structure;
-        sha256_init(&calculated_hash);
-        sha256_update(&calculated_hash, data, len);
-        sha256_sum(&calculated_hash, outputted_hash);
-    } else {
-        md5_t calculated_hash = hashes.md5_structure;
-        md5_init(&calculated_hash);
-        md5_update(&calculated_hash, data, len);
-        md5_sum(&calculated_hash, outputted_hash);
-    }
+    hash_init(&hashes);
+    hash_update(&hashes, data, len);
+    hash_final(&hashes, outputted_hash);
 }
 
 /* Function to print the hash */
@@ -51,3 +119,17 @@ void print_hash(
     }
     printf("\n");
 }
+
+/* There is no memcmp() in the stripped down runtime library. */
+int hash_is_equal(
+    void const *a,
+    void const *b,
+    size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (((uint8_t const *)a)[i] != ((uint8_t const *)b)[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
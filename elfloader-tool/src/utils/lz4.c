@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <types.h>
+#include <strops.h>
+
+#include "../lz4.h"
+
+/*
+ * Read a length that continues in extra bytes if its 4-bit start value is 15.
+ * Returns -1 if the input ends before the length does.
+ */
+static int read_length(
+    uint8_t const **src,
+    uint8_t const *src_end,
+    size_t *len)
+{
+    if (*len != 15) {
+        return 0;
+    }
+
+    uint8_t b;
+    do {
+        if (*src >= src_end) {
+            return -1;
+        }
+        b = *(*src)++;
+        *len += b;
+    } while (b == 255);
+
+    return 0;
+}
+
+/*
+ * An LZ4 block is a sequence of literal runs, each followed by a match that
+ * copies data from earlier output. The last sequence has just literals.
+ */
+int lz4_decompress_block(
+    void *dest,
+    size_t dest_len,
+    void const *src,
+    size_t src_len)
+{
+    uint8_t *out = dest;
+    uint8_t *out_end = out + dest_len;
+    uint8_t const *in = src;
+    uint8_t const *in_end = in + src_len;
+
+    while (in < in_end) {
+        uint8_t token = *in++;
+
+        size_t literal_len = token >> 4;
+        if (0 != read_length(&in, in_end, &literal_len)) {
+            return -1;
+        }
+        if ((literal_len > (size_t)(in_end - in)) ||
+            (literal_len > (size_t)(out_end - out))) {
+            return -1;
+        }
+        memcpy(out, in, literal_len);
+        out += literal_len;
+        in += literal_len;
+
+        if (in == in_end) {
+            /* The last sequence has no match. */
+            break;
+        }
+
+        if (in_end - in < 2) {
+            return -1;
+        }
+        size_t offset = in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if ((offset == 0) || (offset > (size_t)(out - (uint8_t *)dest))) {
+            return -1;
+        }
+
+        size_t match_len = token & 0xf;
+        if (0 != read_length(&in, in_end, &match_len)) {
+            return -1;
+        }
+        match_len += 4;
+        if (match_len > (size_t)(out_end - out)) {
+            return -1;
+        }
+
+        uint8_t const *match = out - offset;
+        if (offset >= match_len) {
+            memcpy(out, match, match_len);
+            out += match_len;
+        } else {
+            /* The match overlaps the output, it repeats the last bytes. */
+            while (match_len-- > 0) {
+                *out++ = *match++;
+            }
+        }
+    }
+
+    return (out == out_end) ? 0 : -1;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+#include <printf.h>
+#include <elfloader_common.h>
+#include <binaries/elf/elf.h>
+
+#include "hash.h"
+#include "warm_boot.h"
+
+_Static_assert(sizeof(struct warm_boot_record) <= BIT(PAGE_BITS),
+               "warm boot record exceeds a page");
+
+/* The record of the previous boot, if it was valid, and the one of this boot. */
+static struct warm_boot_record prev_record;
+static struct warm_boot_record next_record;
+
+static void get_record_digest(struct warm_boot_record const *record,
+                              uint8_t digest[WARM_BOOT_HASH_LEN])
+{
+    hashes_t hashes = { .hash_type = HASH_CONFIG_TYPE };
+
+    memset(digest, 0, WARM_BOOT_HASH_LEN);
+    get_hash(hashes, record, __builtin_offsetof(struct warm_boot_record, digest),
+             digest);
+}
+
+/* Digest of the ELF headers and the writable segments in the ELF file. */
+static void get_file_digest(struct elf_view const *elf,
+                            uint8_t digest[WARM_BOOT_HASH_LEN])
+{
+    hashes_t hashes;
+    struct elf_segment seg;
+
+    hash_init_config(&hashes);
+    hash_update(&hashes, elf->file, elf->phdrs_end);
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        if (seg.flags & PF_W) {
+            hash_update(&hashes,
+                        (void const *)((uintptr_t)elf->file
+                                       + (size_t)seg.offset),
+                        (size_t)seg.file_size);
+        }
+    }
+
+    memset(digest, 0, WARM_BOOT_HASH_LEN);
+    hash_final(&hashes, digest);
+}
+
+static void get_range_digest(paddr_t dest_paddr,
+                             struct warm_boot_range const *range,
+                             uint8_t digest[WARM_BOOT_HASH_LEN])
+{
+    hashes_t hashes = { .hash_type = HASH_CONFIG_TYPE };
+
+    memset(digest, 0, WARM_BOOT_HASH_LEN);
+    get_hash(hashes, (void const *)(dest_paddr + (size_t)range->offset),
+             (size_t)range->size, digest);
+}
+
+/*
+ * Get the read-only segments with data as ranges of the image. Returns their
+ * number, or -1 if there are more than WARM_BOOT_MAX_RANGES.
+ */
+static int get_ranges(struct elf_view const *elf,
+                      struct warm_boot_range ranges[WARM_BOOT_MAX_RANGES])
+{
+    struct elf_segment seg;
+    int num_ranges = 0;
+
+    for (unsigned int i = 0; elf_view_next_load_segment(elf, &i, &seg); i++) {
+        if ((seg.flags & PF_W) || (seg.file_size == 0)) {
+            continue;
+        }
+        if (num_ranges == WARM_BOOT_MAX_RANGES) {
+            return -1;
+        }
+        ranges[num_ranges].offset = seg.vaddr - elf->min_vaddr;
+        ranges[num_ranges].size = seg.file_size;
+        num_ranges++;
+    }
+    return num_ranges;
+}
+
+/*
+ * If the ELF headers match the record, so do the segments, and the ranges of
+ * the record can be used as they are. Only they are read at the destination.
+ */
+static int is_image_intact(
+    struct elf_view const *elf,
+    struct warm_boot_image const *image,
+    paddr_t dest_paddr)
+{
+    uint8_t digest[WARM_BOOT_HASH_LEN];
+
+    get_file_digest(elf, digest);
+    if (!hash_is_equal(digest, image->file_digest, sizeof(digest)) ||
+        (image->num_ranges > WARM_BOOT_MAX_RANGES)) {
+        printf("  ELF file differs from previous boot\n");
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < image->num_ranges; i++) {
+        get_range_digest(dest_paddr, &image->ranges[i], digest);
+        if (!hash_is_equal(digest, image->ranges[i].digest, sizeof(digest))) {
+            printf("  image in memory changed since previous boot\n");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void warm_boot_init(void)
+{
+    struct warm_boot_record *record = (void *)WARM_BOOT_RECORD_PADDR;
+    uint8_t digest[WARM_BOOT_HASH_LEN];
+
+    memcpy(&prev_record, record, sizeof(prev_record));
+    get_record_digest(&prev_record, digest);
+    if ((prev_record.magic != WARM_BOOT_MAGIC) ||
+        (prev_record.version != WARM_BOOT_VERSION) ||
+        (prev_record.num_images > WARM_BOOT_MAX_IMAGES) ||
+        !hash_is_equal(digest, prev_record.digest, sizeof(digest))) {
+        prev_record.num_images = 0;
+    } else {
+        printf("Found load record of previous boot with %u images\n",
+               prev_record.num_images);
+    }
+
+    record->magic = 0;
+
+    next_record.magic = WARM_BOOT_MAGIC;
+    next_record.version = WARM_BOOT_VERSION;
+    next_record.num_images = 0;
+}
+
+int warm_boot_check_image(
+    struct elf_view const *elf,
+    void const *file_hash,
+    size_t hash_len,
+    paddr_t dest_paddr,
+    size_t image_size)
+{
+    for (unsigned int i = 0; i < prev_record.num_images; i++) {
+        struct warm_boot_image const *image = &prev_record.images[i];
+        if ((image->dest_paddr != dest_paddr) ||
+            (image->image_size != image_size) ||
+            !hash_is_equal(image->file_hash, file_hash, hash_len)) {
+            continue;
+        }
+
+        if (!is_image_intact(elf, image, dest_paddr)) {
+            return -1;
+        }
+
+        if (next_record.num_images < WARM_BOOT_MAX_IMAGES) {
+            next_record.images[next_record.num_images++] = *image;
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
+void warm_boot_add_image(
+    struct elf_view const *elf,
+    void const *file_hash,
+    size_t hash_len,
+    paddr_t dest_paddr,
+    size_t image_size)
+{
+    if ((next_record.num_images == WARM_BOOT_MAX_IMAGES) ||
+        (hash_len > WARM_BOOT_HASH_LEN)) {
+        return;
+    }
+
+    struct warm_boot_image *image = &next_record.images[next_record.num_images];
+    memset(image, 0, sizeof(*image));
+    int num_ranges = get_ranges(elf, image->ranges);
+    if (num_ranges < 0) {
+        return;
+    }
+
+    memcpy(image->file_hash, file_hash, hash_len);
+    image->dest_paddr = dest_paddr;
+    image->image_size = image_size;
+    get_file_digest(elf, image->file_digest);
+    image->num_ranges = num_ranges;
+    for (int i = 0; i < num_ranges; i++) {
+        get_range_digest(dest_paddr, &image->ranges[i],
+                         image->ranges[i].digest);
+    }
+    next_record.num_images++;
+}
+
+void warm_boot_finish(void)
+{
+    get_record_digest(&next_record, next_record.digest);
+    memcpy((void *)WARM_BOOT_RECORD_PADDR, &next_record, sizeof(next_record));
+}
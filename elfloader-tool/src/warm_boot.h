@@ -0,0 +1,115 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <elfloader_common.h>
+#include <binaries/elf/elf.h>
+
+#ifdef CONFIG_ELFLOADER_WARM_BOOT
+
+/*
+ * After a soft reset the images are usually still in memory where the previous
+ * boot has put them. The ELF-loader leaves a load record in a reserved page,
+ * which describes for each image the expected hash of its ELF file, where it
+ * went and digests of its data, taken with the configured hash. On the next
+ * boot, an image from the archive that matches a record entry is reused if the
+ * digests still match:
+ *
+ *  - the read-only segments are not copied again, each of them has a digest
+ *    that is checked at its destination.
+ *  - the writable segments have been changed by the previous run, they are
+ *    copied again. The ELF headers and the writable segments in the archive
+ *    have a digest, too, instead of hashing the whole ELF file.
+ *  - everything not backed by the ELF file is zeroed again.
+ *
+ * So only the data that is used is read once, instead of reading the ELF file
+ * and writing the image. The digests come from the record, not from the
+ * archive, and the record is only protected against memory that has changed
+ * by accident. It is no protection against anyone who can write to memory
+ * before the reset. The reserved page must not be given to the kernel, e.g. by
+ * a reserved-memory node in the device tree.
+ */
+
+#define WARM_BOOT_RECORD_PADDR  ((paddr_t)CONFIG_ELFLOADER_WARM_BOOT_RECORD_ADDR)
+
+#define WARM_BOOT_MAGIC         0x4d524157 /* "WARM" */
+#define WARM_BOOT_VERSION       3
+
+/* Images beyond this are always loaded. */
+#define WARM_BOOT_MAX_IMAGES    12
+
+/* Images with more read-only segments are always loaded. */
+#define WARM_BOOT_MAX_RANGES    4
+
+#define WARM_BOOT_HASH_LEN      32
+
+/* A read-only segment at its destination. */
+struct warm_boot_range {
+    uint64_t offset; /* from the start of the image */
+    uint64_t size;
+    uint8_t digest[WARM_BOOT_HASH_LEN];
+};
+
+struct warm_boot_image {
+    uint8_t file_hash[WARM_BOOT_HASH_LEN]; /* expected hash of the ELF file */
+    uint64_t dest_paddr;
+    uint64_t image_size;
+    /* ELF headers and writable segments in the archive */
+    uint8_t file_digest[WARM_BOOT_HASH_LEN];
+    uint32_t num_ranges;
+    uint32_t reserved;
+    struct warm_boot_range ranges[WARM_BOOT_MAX_RANGES];
+};
+
+struct warm_boot_record {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_images;
+    uint32_t reserved;
+    struct warm_boot_image images[WARM_BOOT_MAX_IMAGES];
+    uint8_t digest[WARM_BOOT_HASH_LEN]; /* hash of everything above */
+};
+
+/*
+ * Take over the record of the previous boot, if it is valid. The record in
+ * memory is invalidated, so it never describes a partly loaded set of images.
+ */
+void warm_boot_init(void);
+
+/*
+ * Check whether the ELF file with the expected hash 'file_hash' was loaded to
+ * [dest_paddr..dest_paddr+image_size) by the previous boot and is still
+ * intact. Returns 0 if so, then only the writable segments must be copied and
+ * the unbacked ranges zeroed, the image is carried over to the new record.
+ * Nothing is written to the image in any case.
+ */
+int warm_boot_check_image(
+    struct elf_view const *elf,
+    void const *file_hash,
+    size_t hash_len,
+    paddr_t dest_paddr,
+    size_t image_size);
+
+/*
+ * Add an image that has been loaded and verified to the new record. The
+ * digests are taken of the data at its destination, so it must be complete.
+ */
+void warm_boot_add_image(
+    struct elf_view const *elf,
+    void const *file_hash,
+    size_t hash_len,
+    paddr_t dest_paddr,
+    size_t image_size);
+
+/* Write the new record once all images have been loaded. */
+void warm_boot_finish(void);
+
+#endif /* CONFIG_ELFLOADER_WARM_BOOT */
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+#include <elfloader_common.h>
+
+#ifdef CONFIG_ARCH_ARM
+#include <armv/machine.h>
+#endif
+
+#include "workers.h"
+
+/*
+ * Each worker has a queue that is filled by the boot core only and drained by
+ * the worker only, so plain loads and stores plus barriers are sufficient. This
+ * runs with the MMU off, where exclusive accesses are not guaranteed to work.
+ */
+struct worker_job {
+    void (*func)(void *arg); /* NULL for memcpy() and memset() */
+    void *dest; /* 'arg' for func() */
+    void const *src; /* NULL for memset() */
+    size_t size;
+    int c;
+};
+
+struct worker {
+    volatile unsigned int online;
+    volatile unsigned int head; /* written by the boot core */
+    volatile unsigned int tail; /* written by the worker */
+    struct worker_job jobs[WORKERS_QUEUE_LEN];
+};
+
+/* Index 0 is the boot core, which never takes jobs. */
+static struct worker workers[CONFIG_MAX_NUM_NODES];
+static volatile int is_released;
+static unsigned int next_worker;
+
+static inline void workers_fence(void)
+{
+#if defined(CONFIG_ARCH_ARM)
+    dsb();
+#elif defined(CONFIG_ARCH_RISCV)
+    asm volatile("fence rw, rw" ::: "memory");
+#endif
+}
+
+static void run_job(struct worker_job const *job)
+{
+    if (job->func) {
+        job->func(job->dest);
+    } else if (job->src) {
+        memcpy(job->dest, job->src, job->size);
+    } else {
+        memset(job->dest, job->c, job->size);
+    }
+}
+
+void worker_loop(unsigned int id)
+{
+    if ((id == 0) || (id >= CONFIG_MAX_NUM_NODES)) {
+        return;
+    }
+
+    struct worker *w = &workers[id];
+    w->online = 1;
+    workers_fence();
+
+    for (;;) {
+        unsigned int tail = w->tail;
+        if (tail == w->head) {
+            /* The boot core releases the workers only when all queues are
+             * empty and never queues anything afterwards.
+             */
+            if (is_released) {
+                return;
+            }
+            continue;
+        }
+        /* Don't read the job before seeing the updated head. */
+        workers_fence();
+        run_job(&w->jobs[tail % WORKERS_QUEUE_LEN]);
+        /* Make the job's writes visible before it is marked as done. */
+        workers_fence();
+        w->tail = tail + 1;
+    }
+}
+
+unsigned int workers_online(void)
+{
+    unsigned int num = 0;
+
+    for (unsigned int i = 1; i < CONFIG_MAX_NUM_NODES; i++) {
+        num += workers[i].online ? 1 : 0;
+    }
+
+    return num;
+}
+
+static void queue_job(struct worker_job const *job)
+{
+    for (unsigned int i = 0; i < CONFIG_MAX_NUM_NODES; i++) {
+        struct worker *w = &workers[next_worker];
+        next_worker = (next_worker + 1) % CONFIG_MAX_NUM_NODES;
+
+        unsigned int head = w->head;
+        if (!w->online || (head - w->tail >= WORKERS_QUEUE_LEN)) {
+            continue;
+        }
+        w->jobs[head % WORKERS_QUEUE_LEN] = *job;
+        /* Make the job visible before the worker sees the new head. */
+        workers_fence();
+        w->head = head + 1;
+        return;
+    }
+
+    /* All queues are full, don't wait for them. */
+    run_job(job);
+}
+
+static void split_job(void *dest, void const *src, int c, size_t n)
+{
+    unsigned int num_workers = workers_online();
+    if ((num_workers == 0) || (n < 2 * WORKERS_MIN_SLICE_SIZE)) {
+        struct worker_job job = { .dest = dest, .src = src, .size = n, .c = c };
+        if (num_workers == 0) {
+            run_job(&job);
+        } else {
+            queue_job(&job);
+        }
+        return;
+    }
+
+    size_t slice = n / num_workers;
+    if (slice < WORKERS_MIN_SLICE_SIZE) {
+        slice = WORKERS_MIN_SLICE_SIZE;
+    }
+    size_t pos = 0;
+    while (pos < n) {
+        size_t len = MIN(n - pos, slice);
+        /* Don't leave a small slice at the end. */
+        if (n - pos - len < WORKERS_MIN_SLICE_SIZE) {
+            len = n - pos;
+        }
+        struct worker_job job = {
+            .dest = (char *)dest + pos,
+            .src = src ? (char const *)src + pos : NULL,
+            .size = len,
+            .c = c,
+        };
+        queue_job(&job);
+        pos += len;
+    }
+}
+
+void workers_memcpy(void *dest, void const *src, size_t n)
+{
+    split_job(dest, src, 0, n);
+}
+
+void workers_memset(void *dest, int c, size_t n)
+{
+    split_job(dest, NULL, c, n);
+}
+
+void workers_call(void (*func)(void *arg), void *arg)
+{
+    struct worker_job job = { .func = func, .dest = arg };
+
+    if (workers_online() == 0) {
+        run_job(&job);
+    } else {
+        queue_job(&job);
+    }
+}
+
+void workers_wait(void)
+{
+    for (unsigned int i = 1; i < CONFIG_MAX_NUM_NODES; i++) {
+        struct worker *w = &workers[i];
+        while (w->tail != w->head) {
+            /* spin */
+        }
+    }
+
+    /* Don't let any later access overtake the workers' writes. */
+    workers_fence();
+}
+
+void workers_release(void)
+{
+    workers_wait();
+    is_released = 1;
+    workers_fence();
+}
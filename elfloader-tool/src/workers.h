@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#pragma once
+
+#include <autoconf.h>
+#include <elfloader/gen_config.h>
+
+#include <types.h>
+#include <strops.h>
+
+#ifdef CONFIG_ELFLOADER_PARALLEL_LOAD
+
+/*
+ * The secondary cores are brought up before the images are loaded and help
+ * with copying and zeroing. The boot core splits each request into slices and
+ * queues them for the workers, so it can go on hashing the source while the
+ * workers copy it. Nothing queued is guaranteed to be done before
+ * workers_wait() returns.
+ */
+
+/* Requests smaller than this are not split any further. */
+#define WORKERS_MIN_SLICE_SIZE  (64 * 1024)
+
+/* Number of jobs each worker can have queued. */
+#define WORKERS_QUEUE_LEN       16
+
+/* Main loop of a secondary core, 'id' is its logical core ID. Returns after
+ * workers_release() was called and all queued jobs are done.
+ */
+void worker_loop(unsigned int id);
+
+/* Number of workers that are currently taking jobs. */
+unsigned int workers_online(void);
+
+void workers_memcpy(void *dest, void const *src, size_t n);
+void workers_memset(void *dest, int c, size_t n);
+
+/* Run func(arg) on a worker, or right away if there is none. */
+void workers_call(void (*func)(void *arg), void *arg);
+
+/* Wait until all queued jobs are done. */
+void workers_wait(void);
+
+/* Wait until all queued jobs are done and let the workers leave their loop. */
+void workers_release(void);
+
+#else /* not CONFIG_ELFLOADER_PARALLEL_LOAD */
+
+static inline unsigned int workers_online(void)
+{
+    return 0;
+}
+
+static inline void workers_memcpy(void *dest, void const *src, size_t n)
+{
+    memcpy(dest, src, n);
+}
+
+static inline void workers_memset(void *dest, int c, size_t n)
+{
+    memset(dest, c, n);
+}
+
+static inline void workers_call(void (*func)(void *arg), void *arg)
+{
+    func(arg);
+}
+
+static inline void workers_wait(void) {}
+static inline void workers_release(void) {}
+
+#endif /* [not] CONFIG_ELFLOADER_PARALLEL_LOAD */
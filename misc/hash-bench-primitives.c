@@ -0,0 +1,25 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* The hashes call their block functions through the ELF-loader's table of
+ * loader primitives. The benchmark does not probe the CPU, so its table just
+ * has the portable variants.
+ */
+
+#include <types.h>
+#include <primitives.h>
+
+#include "crypt_sha256.h"
+#ifdef HAVE_CRC32C
+#include "crypt_crc32c.h"
+#endif
+
+struct primitives primitives = {
+    .sha256_blocks = sha256_blocks_generic,
+#ifdef HAVE_CRC32C
+    .crc32c_update = crc32c_update_generic,
+#endif
+};
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2021, HENSOLDT Cyber
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Host benchmark for the hash implementations of the ELF-loader.
+ *
+ * The ELF-loader's crypt_*.c files are compiled for the host with the same
+ * freestanding flags as in the ELF-loader, then each hash is checked against
+ * known digests and its throughput is measured on aligned and unaligned data.
+ * Build it from two revisions (see Makefile.hash_bench) to see whether a change
+ * made a hash faster or slower.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crypt_sha256.h"
+#include "crypt_md5.h"
+#ifdef HAVE_BLAKE2S
+#include "crypt_blake2s.h"
+#endif
+#ifdef HAVE_CRC32C
+#include "crypt_crc32c.h"
+#endif
+
+#define MIN_SECONDS 0.5
+
+/* A test message, 'text' repeated 'repeat' times. */
+struct vector {
+    const char *text;
+    size_t repeat;
+};
+
+/* The longest message, the buffer for checking must hold it. */
+#define MAX_VECTOR_LEN 1000000
+
+/*
+ * The NIST and RFC messages of one and two blocks, messages around the 56 to
+ * 64 byte padding boundary and one of many blocks. Each is hashed at an
+ * aligned address and one byte off, so both the word and the byte loads are
+ * checked.
+ */
+static const struct vector vectors[] = {
+    { "abc", 1 },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1 },
+    {
+        "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+        "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1
+    },
+    { "a", 55 },
+    { "a", 63 },
+    { "a", 64 },
+    { "a", MAX_VECTOR_LEN },
+};
+
+#define NUM_VECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+struct hash {
+    const char *name;
+    size_t len;
+    /* digest of each message in 'vectors' */
+    const char *digests[NUM_VECTORS];
+    void (*get)(const void *data, size_t len, uint8_t *md);
+};
+
+static void get_sha256(const void *data, size_t len, uint8_t *md)
+{
+    sha256_t s;
+    sha256_init(&s);
+    sha256_update(&s, data, len);
+    sha256_sum(&s, md);
+}
+
+static void get_md5(const void *data, size_t len, uint8_t *md)
+{
+    md5_t s;
+    md5_init(&s);
+    md5_update(&s, data, len);
+    md5_sum(&s, md);
+}
+
+#ifdef HAVE_BLAKE2S
+static void get_blake2s(const void *data, size_t len, uint8_t *md)
+{
+    blake2s_t s;
+    blake2s_init(&s);
+    blake2s_update(&s, data, len);
+    blake2s_sum(&s, md);
+}
+#endif
+
+#ifdef HAVE_CRC32C
+static void get_crc32c(const void *data, size_t len, uint8_t *md)
+{
+    crc32c_t s;
+    crc32c_init(&s);
+    crc32c_update(&s, data, len);
+    crc32c_sum(&s, md);
+}
+#endif
+
+static const struct hash hashes[] = {
+    {
+        "sha256", 32,
+        {
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+            "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318",
+            "7d3e74a05d7db15bce4ad9ec0658ea98e3f06eeecf16b4c6fff2da457ddc2f34",
+            "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb",
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+        },
+        get_sha256
+    },
+    {
+        "md5", 16,
+        {
+            "900150983cd24fb0d6963f7d28e17f72",
+            "8215ef0796a20bcaaae116d3876c664a",
+            "03dd8807a93175fb062dfb55dc7d359c",
+            "ef1772b6dff9a122358552954ad0df65",
+            "b06521f39153d618550606be297466d5",
+            "014842d480b571495a4a0363793f7367",
+            "7707d6ae4e027c70eea2a935c2296f21",
+        },
+        get_md5
+    },
+#ifdef HAVE_BLAKE2S
+    {
+        "blake2s", 32,
+        {
+            "508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982",
+            "6f4df5116a6f332edab1d9e10ee87df6557beab6259d7663f3bcd5722c13f189",
+            "358dd2ed0780d4054e76cb6f3a5bce2841e8e2f547431d4d09db21b66d941fc7",
+            "8265e9235687e0db03e94d2827d2c44f5bcb2c9a51e3cd3198078500bc58e5f1",
+            "9a4267618070af968ff2a0fdaecc62b5c15ab91cb4a56424ba9fcad20aab417c",
+            "651d2f5f20952eacaea2fba2f2af2bcd633e511ea2d2e4c9ae2ac0d9ffb7b252",
+            "bec0c0e6cde5b67acb73b81f79a67a4079ae1c60dac9d2661af18e9f8b50dfa5",
+        },
+        get_blake2s
+    },
+#endif
+#ifdef HAVE_CRC32C
+    {
+        "crc32c", 4,
+        {
+            "364b3fb7",
+            "071325f5",
+            "3f60a4b9",
+            "5d552ec6",
+            "029fdbc5",
+            "37aeee33",
+            "436fe240",
+        },
+        get_crc32c
+    },
+#endif
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Put message 'vector' at 'buf', returns its length. */
+static size_t put_vector(const struct vector *vector, uint8_t *buf)
+{
+    size_t text_len = strlen(vector->text);
+
+    for (size_t i = 0; i < vector->repeat; i++) {
+        memcpy(buf + i * text_len, vector->text, text_len);
+    }
+    return vector->repeat * text_len;
+}
+
+/* Check each message at offset 0 and 1 of 'buf'. */
+static int check(const struct hash *hash, uint8_t *buf)
+{
+    uint8_t md[32];
+    char hex[65];
+    int ret = 0;
+
+    for (size_t i = 0; i < NUM_VECTORS; i++) {
+        for (size_t offset = 0; offset < 2; offset++) {
+            size_t len = put_vector(&vectors[i], buf + offset);
+            hash->get(buf + offset, len, md);
+            for (size_t j = 0; j < hash->len; j++) {
+                sprintf(hex + 2 * j, "%02x", md[j]);
+            }
+            if (strcmp(hex, hash->digests[i]) != 0) {
+                fprintf(stderr, "%s: wrong digest %s of %zu bytes at offset "
+                        "%zu, expected %s\n", hash->name, hex, len, offset,
+                        hash->digests[i]);
+                ret = -1;
+            }
+        }
+    }
+    return ret;
+}
+
+/* Returns the best throughput in MB/s of hashing 'len' bytes at 'data'. */
+static double measure(const struct hash *hash, const uint8_t *data, size_t len)
+{
+    double best = 0;
+    double start = now();
+    uint8_t md[32];
+
+    do {
+        double t = now();
+        hash->get(data, len, md);
+        t = now() - t;
+        if (t > 0 && len / t > best) {
+            best = len / t;
+        }
+    } while (now() - start < MIN_SECONDS);
+
+    return best / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size = 4 << 20;
+    int ret = 0;
+
+    if (argc > 1) {
+        size = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2 || size == 0) {
+        fprintf(stderr, "usage: %s [size in bytes]\n", argv[0]);
+        return 1;
+    }
+
+    /* One spare byte for the unaligned case. */
+    uint8_t *data = aligned_alloc(64, size + 64);
+    uint8_t *vector_buf = aligned_alloc(64, MAX_VECTOR_LEN + 64);
+    if (!data || !vector_buf) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    srand(1);
+    for (size_t i = 0; i < size + 64; i++) {
+        data[i] = rand();
+    }
+
+    printf("%-8s %12s %12s   (%zu bytes)\n", "hash", "aligned", "unaligned",
+           size);
+    for (size_t i = 0; i < sizeof(hashes) / sizeof(hashes[0]); i++) {
+        const struct hash *hash = &hashes[i];
+        if (check(hash, vector_buf)) {
+            ret = 1;
+            continue;
+        }
+        printf("%-8s %7.1f MB/s %7.1f MB/s\n", hash->name,
+               measure(hash, data, size), measure(hash, data + 1, size));
+    }
+
+    free(vector_buf);
+    free(data);
+    return ret;
+}